@@ -19,7 +19,7 @@ TARGET		:=	boot
 BUILD		:=	build_boot
 BIN         :=  bin
 SOURCES		:=	boot
-INCLUDES	:=
+INCLUDES	:=	common
 
 #---------------------------------------------------------------------------------
 # options for code generation
@@ -1,11 +1,44 @@
-import sys, lzma
+import sys, lzma, struct
 
-dol = open(sys.argv[1], "rb")
-lzmadol = lzma.open(sys.argv[2], "wb", format=lzma.FORMAT_ALONE)
+# PowerPC branch filter: the target of every relative bl in the text
+# sections is made absolute, so repeated calls to the same function look the
+# same. load.c undoes it while copying the sections out.
+def bcj_encode(data, start, size):
+    for pos in range(start, start + size - 3, 4):
+        word = struct.unpack_from(">I", data, pos)[0]
+        if (word & 0xFC000003) == 0x48000001:
+            word = 0x48000001 | (((word & 0x03FFFFFC) + pos) & 0x03FFFFFC)
+            struct.pack_into(">I", data, pos, word)
 
-dol.seek(0, 2)
-insize = dol.tell()
-dol.seek(0, 0)
+dol = bytearray(open(sys.argv[1], "rb").read())
 
-inbytes = dol.read(insize)
-lzmadol.write(inbytes)
+text_offsets = struct.unpack_from(">7I", dol, 0x00)
+text_sizes = struct.unpack_from(">7I", dol, 0x90)
+for offset, size in zip(text_offsets, text_sizes):
+    if size != 0:
+        bcj_encode(dol, offset, size)
+
+# load.c decodes straight into the sections and only keeps this much of the
+# output around for matches, see DICT_SIZE there
+DICT_SIZE = 0x100000
+
+# Code is all 4-byte words, so position bits help more than the previous
+# byte. Everything else in the DOL still prefers the default, so try both
+# and a couple in between, and keep the smallest.
+best = None
+for lc, lp, pb in [(3, 0, 2), (0, 2, 2), (1, 2, 2), (2, 2, 2)]:
+    filters = [{
+        "id": lzma.FILTER_LZMA1,
+        "preset": 9 | lzma.PRESET_EXTREME,
+        "dict_size": DICT_SIZE,
+        "lc": lc,
+        "lp": lp,
+        "pb": pb,
+    }]
+    out = lzma.compress(bytes(dol), format=lzma.FORMAT_ALONE, filters=filters)
+    print("lc=%d lp=%d pb=%d: %d bytes" % (lc, lp, pb, len(out)))
+    if best is None or len(out) < len(best):
+        best = out
+
+print("%s: %d -> %d bytes" % (sys.argv[1], len(dol), len(best)))
+open(sys.argv[2], "wb").write(best)
@@ -5,6 +5,7 @@
 
 #include "LzmaDec.h"
 #include "sections.h"
+#include <Debug/BootTimeline.h>
 #include <ogc/cache.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,7 +27,12 @@ void LoaderAbort()
     }
 }
 
-#define DECODE_ADDR ((u8*)(0x81200000))
+// LZMA dictionary window, must be at least the dict_size in compress.py
+#define DICT_ADDR ((u8*)(0x81200000))
+#define DICT_SIZE 0x100000
+
+// Copied out after each chunk is decoded, while it's still in the cache
+#define DECODE_CHUNK 0x1000
 
 typedef struct {
     union {
@@ -95,6 +101,74 @@ static inline void copyWords(u32* dest, u32* src, u32 count)
     }
 }
 
+/*
+ * Copy a text section, undoing the branch filter from compress.py: each bl
+ * had the file offset of the instruction added to its target.
+ */
+static inline void copyTextWords(u32* dest, u32* src, u32 count, u32 pos)
+{
+    while (count--) {
+        asm volatile("dcbz    0, %0\n" ::"r"(dest));
+        for (int i = 0; i < 8; i++, pos += 4) {
+            u32 word = src[i];
+            if ((word & 0xFC000003) == 0x48000001)
+                word = 0x48000001 | ((word - pos) & 0x03FFFFFC);
+            dest[i] = word;
+        }
+        asm volatile("dcbf    0, %0\n" ::"r"(dest));
+        dest += 8;
+        src += 8;
+    }
+}
+
+static CLzmaDec s_dec;
+static const u8* s_src;
+static u32 s_srcLen;
+// Offset into the DOL file of the next decoded byte
+static u32 s_pos;
+
+/*
+ * Decode the next size bytes of the DOL and copy them out to dest a chunk at
+ * a time, while they're still in the cache. The dictionary is only a window
+ * of the most recent output. Without a dest, the bytes are skipped.
+ */
+static void decodeTo(u8* dest, u32 size, int text)
+{
+    while (size != 0) {
+        if (s_dec.dicPos == s_dec.dicBufSize)
+            s_dec.dicPos = 0;
+
+        u32 start = s_dec.dicPos;
+        u32 len = size;
+        if (len > DECODE_CHUNK)
+            len = DECODE_CHUNK;
+        if (len > s_dec.dicBufSize - start)
+            len = s_dec.dicBufSize - start;
+
+        SizeT inLen = s_srcLen;
+        ELzmaStatus status;
+        SRes ret = LzmaDec_DecodeToDic(&s_dec, start + len, s_src, &inLen,
+                                       LZMA_FINISH_ANY, &status);
+        s_src += inLen;
+        s_srcLen -= inLen;
+
+        if (ret != SZ_OK || s_dec.dicPos != start + len)
+            LoaderAbort();
+
+        if (dest != 0) {
+            u32* src = (u32*)(s_dec.dic + start);
+            if (text)
+                copyTextWords((u32*)dest, src, len / 32, s_pos);
+            else
+                copyWords((u32*)dest, src, len / 32);
+            dest += len;
+        }
+
+        s_pos += len;
+        size -= len;
+    }
+}
+
 #define INLINE_MEMCPY(__dst, __src, __len)                                     \
     do {                                                                       \
         for (int __i = 0; __i < (__len); __i++) {                              \
@@ -134,6 +208,9 @@ void InitExceptionHandlers()
 
 __attribute__((noreturn)) void load()
 {
+    BootTimelineReset();
+    BootTimelineStamp(BOOT_PPC_LOADER_START);
+
     InitExceptionHandlers();
 
     clearWords(&__bss_start, ((u32)&__bss_end - (u32)&__bss_start) / 32);
@@ -156,30 +233,59 @@ __attribute__((noreturn)) void load()
 
     sections->sectionsMagic = SECTION_SAVE_MAGIC;
 
-    ELzmaStatus status;
-
     u32 channel_dol_lzma_size =
         (const u8*)&channel_dol_lzma_end - channel_dol_lzma;
-    size_t destLen = 0x700000;
-    size_t inLen = channel_dol_lzma_size - 5;
-    SRes ret = LzmaDecode(DECODE_ADDR, &destLen, channel_dol_lzma + 0xD, &inLen,
-                          channel_dol_lzma, LZMA_PROPS_SIZE, LZMA_FINISH_END,
-                          &status, 0);
+    s_src = channel_dol_lzma + 0xD;
+    s_srcLen = channel_dol_lzma_size - 0xD;
 
-    if (ret != SZ_OK)
+    // Only the probabilities are allocated, at the fixed address in 7zTypes.h
+    LzmaDec_Construct(&s_dec);
+    SRes ret =
+        LzmaDec_AllocateProbs(&s_dec, channel_dol_lzma, LZMA_PROPS_SIZE, 0);
+    if (ret != SZ_OK || s_dec.prop.dicSize > DICT_SIZE)
         LoaderAbort();
+    s_dec.dic = DICT_ADDR;
+    s_dec.dicBufSize = DICT_SIZE;
+    LzmaDec_Init(&s_dec);
 
-    DOL* dol = (DOL*)DECODE_ADDR;
-    clearWords((u32*)dol->dol_bss_addr, dol->dol_bss_size / 4);
+    DOL dolHeader;
+    DOL* dol = &dolHeader;
+    decodeTo(0, sizeof(DOL), 0);
+    INLINE_MEMCPY(dol, DICT_ADDR, sizeof(DOL));
 
+    // In lines, not words, or it runs on into the LZMA state
+    clearWords((u32*)dol->dol_bss_addr, (dol->dol_bss_size + 31) / 32);
+
+    // Sections in file order, so each one can be decoded as it comes
+    int order[7 + 11];
+    int count = 0;
     for (int i = 0; i < 7 + 11; i++) {
-        if (dol->dol_sect_size[i] != 0) {
-            copyWords((u32*)dol->dol_sect_addr[i],
-                      (u32*)(DECODE_ADDR + dol->dol_sect[i]),
-                      (dol->dol_sect_size[i] / 4) / 8);
-        }
+        if (dol->dol_sect_size[i] == 0)
+            continue;
+
+        int j = count++;
+        for (; j > 0 && dol->dol_sect[order[j - 1]] > dol->dol_sect[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
     }
 
+    for (int j = 0; j < count; j++) {
+        int i = order[j];
+        u32 offset = dol->dol_sect[i];
+        u32 size = dol->dol_sect_size[i];
+
+        // Overlapping or unaligned sections can't be copied a line at a time
+        if (offset < s_pos || ((offset | size | dol->dol_sect_addr[i]) & 31))
+            LoaderAbort();
+
+        // Padding between sections
+        decodeTo(0, offset - s_pos, 0);
+
+        decodeTo((u8*)dol->dol_sect_addr[i], size, i < 7);
+    }
+
+    BootTimelineStamp(BOOT_PPC_LOADER_DECODED);
+
     (*(void (*)(void))dol->dol_entry_point)();
     while (1) {
     }
@@ -30,6 +30,10 @@ CFLAGS	= -g -Os -DNDEBUG -Wall -Wextra -Wpedantic -Wnull-dereference -Wshadow -W
 	-fno-asynchronous-unwind-tables -fno-unwind-tables -fno-builtin-memcpy -fno-builtin-memset -Wno-pointer-arith \
 	-Wno-unused-variable \
 	$(MACHDEP) $(INCLUDE)
+
+# make LOG_LEVELS="DVD=WARN" overrides Debug/LogConfig.hpp
+CFLAGS	+=	$(foreach level,$(LOG_LEVELS),-DLOG_LEVEL_$(level))
+
 CXXFLAGS	=	$(CFLAGS) -std=c++20 -fno-rtti -Wno-register -Wno-narrowing
 
 LDFLAGS	=	-g $(MACHDEP) -Wl,-Map,$(OUTPUT).map -Wl,--section-start,.init=0x80800000
@@ -4,55 +4,70 @@
 // SPDX-License-Identifier: MIT
 
 #include "Arch.hpp"
-#include <stdio.h>
+#include <cassert>
+#include <stdlib.h>
 #include <string.h>
 
 Arch* Arch::sInstance;
 
-bool Arch::getShortName(const char* name, char* out)
-{
-    if (m_lfnFile == nullptr)
-        return false;
-
-    const char* start = m_lfnFile;
-    const char* end = m_lfnFile + m_lfnFileSize;
+static constexpr char ArchMagic[] = "!<arch>\n";
+static constexpr u32 HeaderSize = 0x3C;
 
-    while (start < end) {
-        if (*start == '\n' || *start == ' ') {
+/*
+ * Call back with the name, size and data of every subfile, in order.
+ */
+template <class Callback>
+static void ForEachSubfile(const char* start, const char* end,
+                           Callback callback)
+{
+    while (start + HeaderSize <= end) {
+        if (*start == '\n') {
             start++;
             continue;
         }
 
-        const char* fnend = strchr(start, '/');
-        u32 len = fnend - start;
-        if (strlen(name) == len && !strncmp(start, name, len)) {
-            snprintf(out, 8, "/%d", start - m_lfnFile);
-            return true;
+        const char* fnend;
+        if (start[0] != '/') {
+            fnend = strchr(start + 1, '/');
+        } else {
+            fnend = strchr(start + 1, ' ');
         }
-        start = fnend + 1;
+
+        const u32 size = atoi(start + 0x30);
+        callback(start, u32(fnend - start), size, start + HeaderSize);
+
+        start += HeaderSize + size;
     }
+}
 
-    return false;
+/*
+ * FNV-1a.
+ */
+u32 Arch::hashName(const char* name, u32 len)
+{
+    u32 hash = 0x811C9DC5;
+    for (u32 i = 0; i < len; i++) {
+        hash ^= u8(name[i]);
+        hash *= 0x01000193;
+    }
+    return hash;
 }
 
 const void* Arch::getFile(const char* name, u32* size)
 {
-    char shortName[8];
-    const char* rname = name;
+    if (!m_valid)
+        return nullptr;
 
-    if (strlen(name) > 15) {
-        if (!getShortName(name, shortName))
-            return nullptr;
-        rname = shortName;
-    }
+    const u32 len = strlen(name);
 
-    for (auto it : m_subfiles) {
-        if (strlen(rname) == it.nameLen &&
-            !strncmp(rname, it.name, it.nameLen)) {
+    for (u32 bucket = hashName(name, len) & m_bucketMask;
+         m_buckets[bucket] != 0; bucket = (bucket + 1) & m_bucketMask) {
+        const Subfile& subfile = m_subfiles[m_buckets[bucket] - 1];
+        if (subfile.nameLen == len && !memcmp(subfile.name, name, len)) {
             if (size != nullptr) {
-                *size = it.size;
+                *size = subfile.size;
             }
-            return it.data;
+            return subfile.data;
         }
     }
     return nullptr;
@@ -66,45 +81,64 @@ const void* Arch::getFileStatic(const char* name, u32* size)
 Arch::Arch(const char* file, u32 size)
 {
     m_file = file;
-    m_lfnFile = nullptr;
+    m_subfiles = nullptr;
+    m_subfileCount = 0;
+    m_buckets = nullptr;
+    m_bucketMask = 0;
 
-    if (strncmp(m_file, "!<arch>\n", sizeof("!<arch>\n") - 1)) {
+    if (strncmp(m_file, ArchMagic, sizeof(ArchMagic) - 1)) {
         m_valid = false;
         return;
     }
 
-    std::vector<const char*> m_longFileNames;
-    const char* start = m_file + sizeof("!<arch>\n") - 1;
-    const char* end = start + size;
-
-    while (start + 0x3C <= end) {
-        if (*start == '\n') {
-            start++;
-            continue;
-        }
-
-        const char* fnend;
-        if (start[0] != '/') {
-            fnend = strchr(start + 1, '/');
-        } else {
-            fnend = strchr(start + 1, ' ');
+    const char* start = m_file + sizeof(ArchMagic) - 1;
+    const char* end = m_file + size;
+
+    // Count the subfiles and find the long name table first, so the index
+    // can be allocated once
+    const char* lfnFile = nullptr;
+    u32 count = 0;
+    ForEachSubfile(start, end,
+                   [&](const char* name, u32 nameLen, u32, const char* data) {
+                       if (nameLen == 2 && !strncmp(name, "//", 2))
+                           lfnFile = data;
+                       count++;
+                   });
+    assert(count < 0xFFFF);
+
+    // At most half full
+    u32 bucketCount = 16;
+    while (bucketCount < count * 2)
+        bucketCount *= 2;
+
+    m_subfiles = new Subfile[count];
+    m_buckets = new u16[bucketCount];
+    memset(m_buckets, 0, bucketCount * sizeof(u16));
+    m_bucketMask = bucketCount - 1;
+
+    ForEachSubfile(start, end, [&](const char* name, u32 nameLen, u32 subSize,
+                                   const char* data) {
+        // "/123" is the name at offset 123 in the long name table. The table
+        // itself is "//" and the symbol table "/".
+        if (lfnFile != nullptr && nameLen > 1 && name[0] == '/' &&
+            name[1] >= '0' && name[1] <= '9') {
+            name = lfnFile + atoi(name + 1);
+            nameLen = strchr(name, '/') - name;
         }
 
-        Subfile subfile;
-        subfile.name = start;
-        subfile.nameLen = fnend - start;
-        subfile.size = atoi(start + 0x30);
-        subfile.data = start + 0x3C;
-        m_subfiles.push_back(subfile);
+        m_subfiles[m_subfileCount] = {
+            .name = name,
+            .nameLen = nameLen,
+            .size = subSize,
+            .data = data,
+        };
 
-        if (subfile.nameLen == 2 && !strncmp(subfile.name, "//", 2)) {
-            m_lfnFile = subfile.data;
-            m_lfnFileSize = subfile.size;
-        }
-
-        start += 0x3C + subfile.size;
-    }
+        // Duplicates go later in the chain, so the first one is found
+        u32 bucket = hashName(name, nameLen) & m_bucketMask;
+        while (m_buckets[bucket] != 0)
+            bucket = (bucket + 1) & m_bucketMask;
+        m_buckets[bucket] = ++m_subfileCount;
+    });
 
     m_valid = true;
-    return;
 }
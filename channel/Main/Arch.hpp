@@ -5,7 +5,6 @@
 
 #pragma once
 #include <System/Types.h>
-#include <vector>
 
 class Arch
 {
@@ -13,20 +12,26 @@ public:
     static Arch* sInstance;
 
     Arch(const char* file, u32 size);
-    bool getShortName(const char* name, char* out);
     const void* getFile(const char* name, u32* size = nullptr);
     static const void* getFileStatic(const char* name, u32* size = nullptr);
 
 private:
+    static u32 hashName(const char* name, u32 len);
+
     const char* m_file;
     bool m_valid;
+
+    // Long names are resolved through the // table when the index is built
     struct Subfile {
         const char* name;
         u32 nameLen;
         u32 size;
         const char* data;
     };
-    std::vector<Subfile> m_subfiles;
-    const char* m_lfnFile;
-    u32 m_lfnFileSize;
+    Subfile* m_subfiles;
+    u32 m_subfileCount;
+
+    // Open addressed, holds subfile index + 1 or zero if empty
+    u16* m_buckets;
+    u32 m_bucketMask;
 };
@@ -6,9 +6,11 @@
 #include "IOSBoot.hpp"
 #include "Arch.hpp"
 #include "LaunchState.hpp"
+#include <Debug/BootTimeline.h>
 #include <Debug/Log.hpp>
 #include <System/Hollywood.hpp>
 #include <System/Util.h>
+#include <cstddef>
 #include <new>
 #include <ogc/cache.h>
 #include <stdio.h>
@@ -36,33 +38,55 @@ constexpr u32 syscall(u32 id)
 }
 
 constexpr u32 VFILE_ADDR = 0x91000000;
-constexpr u32 VFILE_SIZE = 0x100000;
 
-template <u32 TSize>
+/*
+ * Tells the IOS loader where the module ELF is. The loader reads it in place
+ * from the archive, with m_ident standing in for the start of it so the
+ * header can be patched without a copy. The ELF may be compressed, see
+ * ios/Loader/compress.py, in which case m_length is the decompressed size.
+ */
 struct VFile {
     static constexpr u32 MAGIC = 0x46494C45; /* FILE */
+    static constexpr u32 LZ4C_MAGIC = 0x4C5A3443; /* LZ4C */
 
-    VFile(const void* data, u32 len) : m_magic(MAGIC), m_length(len), m_pos(0)
+    VFile(const void* data, u32 len)
+        : m_magic(MAGIC), m_length(len), m_pos(0), m_ready(0),
+          m_data(reinterpret_cast<u32>(data) & ~0xC0000000)
     {
-        ASSERT(len <= TSize);
-        ASSERT(len >= 0x34);
-        ASSERT(!memcmp(data,
+        // The compressed header has a copy of the start of the ELF
+        const u8* start = static_cast<const u8*>(data);
+        u32 magic;
+        memcpy(&magic, start, sizeof(magic));
+        if (magic == LZ4C_MAGIC) {
+            memcpy(&m_length, start + 4, sizeof(m_length));
+            start += 0x10;
+        }
+
+        ASSERT(m_length >= 0x34);
+        ASSERT(!memcmp(start,
                        "\x7F"
                        "ELF",
                        4));
-        memcpy(m_data, data, len);
-        m_data[7] = 0x61;
-        m_data[8] = 1;
-        IOSBoot::SafeFlushRange(reinterpret_cast<void*>(this), 32 + len);
+        memcpy(m_ident, start, sizeof(m_ident));
+        m_ident[7] = 0x61;
+        m_ident[8] = 1;
+        IOSBoot::SafeFlushRange(reinterpret_cast<void*>(this), sizeof(VFile));
     }
 
     u32 m_magic;
     u32 m_length;
     u32 m_pos;
-    u32 m_pad[8 - 3];
-    u8 m_data[TSize];
+    // Log::IPCLogReadyMagic once /dev/saoirse is registered
+    u32 m_ready;
+    // Physical address of the ELF
+    u32 m_data;
+    u8 m_ident[12];
 };
 
+static_assert(sizeof(VFile) == 32);
+static_assert((VFILE_ADDR & ~0xC0000000) + offsetof(VFile, m_ready) ==
+              Log::IPCLogReadyAddr);
+
 /*
  * Performs an IOS exploit and branches to the entrypoint in system mode.
  *
@@ -125,7 +149,7 @@ void IOSBoot::SafeFlushRange(const void* data, u32 len)
 /* Async ELF launch */
 s32 IOSBoot::Launch(const void* data, u32 len)
 {
-    new (reinterpret_cast<void*>(VFILE_ADDR)) VFile<VFILE_SIZE>(data, len);
+    new (reinterpret_cast<void*>(VFILE_ADDR)) VFile(data, len);
 
     u32 loaderSize;
     const void* loader = Arch::getFileStatic("ios_loader.bin", &loaderSize);
@@ -137,10 +161,31 @@ s32 IOSBoot::Launch(const void* data, u32 len)
     return Entry(reinterpret_cast<u32>(loaderMemory) & ~0xC0000000);
 }
 
+/*
+ * Wait for IOS to register /dev/saoirse. Only reads MEM2, where opening it
+ * would queue up IPC requests for nothing. If it times out, the IPCLog
+ * constructor still retries the open.
+ */
+static void WaitForIPCLogReady()
+{
+    volatile u32* ready =
+        reinterpret_cast<volatile u32*>(Log::IPCLogReadyAddr | 0xC0000000);
+
+    for (s32 i = 0; i < 10000; i++) {
+        if (*ready == Log::IPCLogReadyMagic)
+            return;
+        usleep(100);
+    }
+
+    PRINT(Core, WARN, "Timed out waiting for /dev/saoirse");
+}
+
 void IOSBoot::LaunchSaoirseIOS()
 {
     u32 elfSize = 0;
-    const void* elf = Arch::getFileStatic("saoirse_ios.elf", &elfSize);
+    const void* elf = Arch::getFileStatic("saoirse_ios.elf.lz4", &elfSize);
+    if (elf == nullptr)
+        elf = Arch::getFileStatic("saoirse_ios.elf", &elfSize);
     assert(elf != nullptr);
 
 #ifdef IOS_LAUNCH_FAIL_DEBUG
@@ -148,10 +193,13 @@ void IOSBoot::LaunchSaoirseIOS()
 #endif
 
     PRINT(Core, INFO, "Starting up Saoirse IOS...");
+    BootTimelineStamp(BOOT_PPC_IOS_LAUNCH);
     s32 ret = Launch(elf, elfSize);
+    BootTimelineStamp(BOOT_PPC_IOS_LAUNCHED);
     PRINT(Core, INFO, "IOSBoot::Launch result: %d", ret);
 
     if (ret == IOSError::OK) {
+        WaitForIPCLogReady();
         IPCLog::sInstance = new IPCLog();
     }
 
@@ -296,7 +344,7 @@ void IOSBoot::DebugLaunchReport()
     // will work regardless if whether or not IOS is currently functional.
 
     // Check VFile status
-    auto vf = (VFile<VFILE_SIZE>*)VFILE_ADDR;
+    auto vf = (VFile*)VFILE_ADDR;
     PRINT(Core, INFO, "VFile::m_length = 0x%08X", vf->m_length);
     PRINT(Core, INFO, "VFile::m_pos = 0x%08X", vf->m_pos);
 
@@ -357,6 +405,7 @@ void IOSBoot::IPCLog::startGameIOS(void* dolData, u32 dolSize)
 {
     Queue<u32> eventWaitQueue(1);
     setEventWaitingQueue(&eventWaitQueue, 5);
+    BootTimelineStamp(BOOT_PPC_START_REQUEST);
     logRM.ioctl(Log::IPCLogIoctl::StartGameEvent, dolData, dolSize, nullptr, 0);
 
     // Invalidate this while we're waiting for IOS
@@ -365,9 +414,10 @@ void IOSBoot::IPCLog::startGameIOS(void* dolData, u32 dolSize)
     ICInvalidateRange((void*)0x80004000, 0x300000);
 
     eventWaitQueue.receive();
+    BootTimelineStamp(BOOT_PPC_START_DONE);
 }
 
-bool IOSBoot::IPCLog::handleEvent(s32 result)
+bool IOSBoot::IPCLog::handleEvent(s32 result, const void* data)
 {
     if (result < 0) {
         PRINT(Core, ERROR, "/dev/saoirse error: %d", result);
@@ -376,11 +426,11 @@ bool IOSBoot::IPCLog::handleEvent(s32 result)
 
     switch (static_cast<Log::IPCLogReply>(result)) {
     case Log::IPCLogReply::Print:
-        puts(logBuffer);
+        puts(reinterpret_cast<const char*>(data));
         return true;
 
     case Log::IPCLogReply::Notice: {
-        u32 id = *(u32*)logBuffer;
+        u32 id = *reinterpret_cast<const u32*>(data);
         PRINT(Core, INFO, "Received resource notify event %d!", id);
         m_eventCount++;
 
@@ -392,7 +442,7 @@ bool IOSBoot::IPCLog::handleEvent(s32 result)
     }
 
     case Log::IPCLogReply::SetLaunchState: {
-        u32 state = *(u32*)logBuffer;
+        u32 state = *reinterpret_cast<const u32*>(data);
         PRINT(Core, INFO, "Received launch state: %d", state);
         LaunchState::Get()->Error.state = LaunchError(state);
         return true;
@@ -405,15 +455,98 @@ bool IOSBoot::IPCLog::handleEvent(s32 result)
     return true;
 }
 
+/*
+ * Hand IOS a shared memory ring to write log records and events into, so it
+ * doesn't have to wait for us to re-issue RegisterPrintHook for every line.
+ */
+bool IOSBoot::IPCLog::registerRing()
+{
+    auto ring = reinterpret_cast<Log::LogRing*>(
+        IOS::Alloc(sizeof(Log::LogRing)));
+    memset(ring, 0, sizeof(Log::LogRing));
+    ring->magic = Log::LogRing::MAGIC;
+
+    // The ioctl flushes the input buffer for us.
+    s32 ret = logRM.ioctl(Log::IPCLogIoctl::RegisterLogRing, ring,
+                          sizeof(Log::LogRing), nullptr, 0);
+    if (ret != IOSError::OK) {
+        PRINT(Core, WARN, "Log ring not supported, using print hook: %d", ret);
+        IOS::Free(ring);
+        return false;
+    }
+
+    m_ring = ring;
+    return true;
+}
+
+/*
+ * Handle every record currently in the ring. Returns false once the close
+ * record has been read.
+ */
+bool IOSBoot::IPCLog::drainRing()
+{
+    constexpr u32 size = Log::LogRing::DataSize;
+
+    // IOS owns the first line and the data, we only ever invalidate those.
+    DCInvalidateRange(m_ring, 32);
+    const u32 writePos = m_ring->writePos;
+    u32 readPos = m_ring->readPos;
+
+    if (m_ring->dropCount != m_ringDropCount) {
+        PRINT(Core, WARN, "Log ring overflow, %u line(s) dropped",
+              m_ring->dropCount - m_ringDropCount);
+        m_ringDropCount = m_ring->dropCount;
+    }
+
+    if (readPos == writePos)
+        return true;
+
+    DCInvalidateRange(m_ring->data, size);
+
+    bool open = true;
+    while (open && readPos != writePos) {
+        auto rec = reinterpret_cast<const Log::LogRecord*>(
+            m_ring->data + readPos % size);
+        readPos += Log::RecordSize(rec->len);
+
+        if (rec->type == Log::RingPad)
+            continue;
+
+        open = handleEvent(rec->type, rec + 1);
+    }
+
+    m_ring->readPos = readPos;
+    DCFlushRange(&m_ring->readPos, 32);
+    return open;
+}
+
 s32 IOSBoot::IPCLog::threadEntry(void* userdata)
 {
     IPCLog* log = reinterpret_cast<IPCLog*>(userdata);
 
+    if (log->m_ring != nullptr) {
+        while (true) {
+            // Doorbell, returns when the ring has something to read
+            s32 result = log->logRM.ioctl(Log::IPCLogIoctl::WaitLogRing,
+                                          nullptr, 0, nullptr, 0);
+            if (result < 0) {
+                // Handle closed, pick up anything written before the close
+                log->drainRing();
+                break;
+            }
+
+            if (!log->drainRing())
+                break;
+        }
+
+        return 0;
+    }
+
     while (true) {
         s32 result =
             log->logRM.ioctl(Log::IPCLogIoctl::RegisterPrintHook, NULL, 0,
                              log->logBuffer, sizeof(log->logBuffer));
-        if (!log->handleEvent(result))
+        if (!log->handleEvent(result, log->logBuffer))
             break;
     }
 
@@ -423,8 +556,7 @@ s32 IOSBoot::IPCLog::threadEntry(void* userdata)
 IOSBoot::IPCLog::IPCLog()
 {
     if (this->logRM.fd() == IOSError::NotFound) {
-        // Unfortunately there isn't really a way to detect the moment the log
-        // resource manager is created, so we just have to keep trying until it
+        // WaitForIPCLogReady timed out, so just keep trying until it
         // succeeds.
         for (s32 i = 0; i < 1000; i++) {
             usleep(1000);
@@ -440,6 +572,7 @@ IOSBoot::IPCLog::IPCLog()
         // again.
         abort();
     }
+    BootTimelineStamp(BOOT_PPC_SAOIRSE_OPENED);
 
     // Set the time on IOS
     u64 epoch = time(nullptr);
@@ -452,6 +585,8 @@ IOSBoot::IPCLog::IPCLog()
                                 nullptr, 0);
     assert(ret == IOSError::OK);
 
+    registerRing();
+
     new (&m_thread)
         Thread(threadEntry, reinterpret_cast<void*>(this), nullptr, 0x800, 80);
 }
@@ -5,6 +5,7 @@
 
 #pragma once
 #include <Debug/Log.hpp>
+#include <Debug/LogRing.hpp>
 #include <System/OS.hpp>
 #include <System/Types.h>
 #include <System/Util.h>
@@ -39,13 +40,19 @@ public:
     }
 
 protected:
-    bool handleEvent(s32 result);
+    bool handleEvent(s32 result, const void* data);
+    bool registerRing();
+    bool drainRing();
     static s32 threadEntry(void* userdata);
 
     bool reset = false;
     IOS::ResourceCtrl<Log::IPCLogIoctl> logRM{"/dev/saoirse"};
     char logBuffer[256] ATTRIBUTE_ALIGN(32);
 
+    // Shared memory ring, or nullptr if IOS only supports the print hook.
+    Log::LogRing* m_ring = nullptr;
+    u32 m_ringDropCount = 0;
+
     int m_eventCount = 0;
     Queue<u32>* m_eventQueue;
     int m_triggerEventCount = -1;
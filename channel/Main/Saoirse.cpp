@@ -8,6 +8,7 @@
 #include "GlobalsConfig.hpp"
 #include "IOSBoot.hpp"
 #include <DVD/DI.hpp>
+#include <Debug/BootTimeline.h>
 #include <Debug/Log.hpp>
 #include <Main/LaunchState.hpp>
 #include <System/ISFS.hpp>
@@ -169,6 +170,9 @@ void LaunchGame()
 
     u32 entryPoint = *(u32*)0xC0003400;
 
+    BootTimelineStamp(BOOT_PPC_LAUNCH_GAME);
+    BootTimeline::Report();
+
     delete IOSBoot::IPCLog::sInstance;
 
     // TODO: Proper shutdown
@@ -250,6 +254,11 @@ void MakeDOLForInstaller(SectionSaveStruct* sections)
 
 s32 main([[maybe_unused]] s32 argc, [[maybe_unused]] char** argv)
 {
+    // The loader stub starts the timeline, unless this was launched directly
+    if (BOOT_TIMELINE->magic != BOOT_TIMELINE_MAGIC)
+        BootTimelineReset();
+    BootTimelineStamp(BOOT_PPC_CHANNEL_MAIN);
+
     // Properly handle PI errors
     IRQ_Request(IRQ_PI_ERROR, PIErrorHandler, nullptr);
     __UnmaskIrq(IM_PI_ERROR);
@@ -269,6 +278,7 @@ s32 main([[maybe_unused]] s32 argc, [[maybe_unused]] char** argv)
     if (IOS_ReloadIOS(58) < 0) {
         abort();
     }
+    BootTimelineStamp(BOOT_PPC_IOS_RELOADED);
 
 #ifndef DISABLE_UI
     Input::sInstance = new Input();
@@ -0,0 +1,177 @@
+// BootTimeline.cpp - Boot stage timestamps shared by the PPC and IOS
+//
+// SPDX-License-Identifier: MIT
+
+#include "BootTimeline.h"
+#include <Debug/Log.hpp>
+#ifdef TARGET_IOS
+#include <Disk/DeviceMgr.hpp>
+#include <IOS/Syscalls.h>
+#include <System/Hollywood.hpp>
+#endif
+#include <algorithm>
+#include <cstdio>
+#include <stdarg.h>
+
+static_assert(sizeof(BootTimelineData) == 128);
+static_assert(BOOT_PPC_STAGE_COUNT <= 15);
+static_assert(BOOT_IOS_STAGE_COUNT <= 16);
+
+constexpr u32 MaxStages = u32(BOOT_PPC_STAGE_COUNT) + BOOT_IOS_STAGE_COUNT;
+
+static const char* const PPCStageNames[BOOT_PPC_STAGE_COUNT] = {
+    "Loader stub start",
+    "LZMA decode",
+    "Channel DOL copy and init",
+    "IOS reload",
+    "Channel setup",
+    "IOSBoot::Launch",
+    "/dev/saoirse open",
+    "Start game request",
+    "Start game events",
+    "LaunchGame",
+};
+
+static const char* const IOSStageNames[BOOT_IOS_STAGE_COUNT] = {
+    "IOS module entry",
+    "/dev/saoirse registered",
+    "Blob mount",
+    "LaunchMainDOL start",
+    "LaunchMainDOL",
+    "Notify 0 (channel DOLs loaded)",
+    "Notify 1 (EmuHID ready)",
+    "Notify 2 (EmuES ready)",
+    "Notify 3 (EmuSDIO ready)",
+    "Notify 4 (game IOS ready)",
+    "LaunchTitle",
+    "LaunchTitle MEM1 clear",
+};
+
+#ifdef TARGET_HOST
+static BootTimelineData s_hostTimeline = {BOOT_TIMELINE_MAGIC, {}, {}};
+#endif
+
+static volatile BootTimelineData* GetTimeline()
+{
+#if defined(TARGET_HOST)
+    return &s_hostTimeline;
+#elif defined(TARGET_IOS)
+    auto timeline =
+        reinterpret_cast<volatile BootTimelineData*>(BOOT_TIMELINE_PHYS);
+    IOS_InvalidateDCache(const_cast<BootTimelineData*>(timeline), 32);
+    return timeline;
+#else
+    return BOOT_TIMELINE;
+#endif
+}
+
+#ifdef TARGET_IOS
+
+void BootTimeline::Stamp(u32 stage)
+{
+    volatile BootTimelineData* timeline = GetTimeline();
+
+    // Nothing reserved the block, don't write over whatever is there
+    if (timeline->magic != BOOT_TIMELINE_MAGIC)
+        return;
+
+#ifdef TARGET_HOST
+    const u32 now = IOS_GetTime();
+#else
+    const u32 now = ACRReadTrusted(ACRReg::TIMER);
+#endif
+
+    timeline->ios[stage] = now != 0 ? now : 1;
+    IOS_FlushDCache(const_cast<u32*>(timeline->ios), sizeof(timeline->ios));
+}
+
+#endif
+
+/*
+ * Not PRINT, the report is wanted in release builds. IOS writes it to log.txt
+ * and the channel to the console.
+ */
+static void WriteLine(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+#ifdef TARGET_IOS
+    char line[96];
+    u32 len = vsnprintf(line, sizeof(line), format, args);
+    len = std::min<u32>(len, sizeof(line) - 1);
+    DeviceMgr::sInstance->WriteToLog(line, len);
+#else
+    Log::VPrint("Core", "Report", Log::LogLevel::INFO, format, args);
+#endif
+
+    va_end(args);
+}
+
+void BootTimeline::Report()
+{
+#ifdef TARGET_IOS
+    if (DeviceMgr::sInstance == nullptr ||
+        !DeviceMgr::sInstance->IsLogEnabled())
+        return;
+#endif
+
+    volatile BootTimelineData* timeline = GetTimeline();
+    if (timeline->magic != BOOT_TIMELINE_MAGIC)
+        return;
+
+#if defined(TARGET_IOS) && !defined(TARGET_HOST)
+    IOS_InvalidateDCache(const_cast<BootTimelineData*>(timeline),
+                         sizeof(BootTimelineData));
+#endif
+
+    u32 stamps[MaxStages];
+    const char* names[MaxStages];
+    u32 count = 0;
+
+    for (u32 i = 0; i < BOOT_PPC_STAGE_COUNT; i++) {
+        if (timeline->ppc[i] != 0) {
+            stamps[count] = timeline->ppc[i];
+            names[count++] = PPCStageNames[i];
+        }
+    }
+
+    for (u32 i = 0; i < BOOT_IOS_STAGE_COUNT; i++) {
+        if (timeline->ios[i] != 0) {
+            stamps[count] = timeline->ios[i];
+            names[count++] = IOSStageNames[i];
+        }
+    }
+
+    if (count == 0)
+        return;
+
+    // The earliest stamp is the base; the timer wraps after 37 minutes, well
+    // beyond any boot
+    u32 base = stamps[0];
+    for (u32 i = 1; i < count; i++) {
+        if (s32(stamps[i] - base) < 0)
+            base = stamps[i];
+    }
+
+    // Insertion sort, there are only a handful
+    for (u32 i = 1; i < count; i++) {
+        const u32 stamp = stamps[i];
+        const char* name = names[i];
+
+        u32 j = i;
+        for (; j > 0 && stamps[j - 1] - base > stamp - base; j--) {
+            stamps[j] = stamps[j - 1];
+            names[j] = names[j - 1];
+        }
+        stamps[j] = stamp;
+        names[j] = name;
+    }
+
+    WriteLine("[Boot] Timeline, us since first stage and since previous:");
+    for (u32 i = 0; i < count; i++) {
+        const u32 at = u64(stamps[i] - base) * 128 / 243;
+        const u32 prev = i == 0 ? 0 : u64(stamps[i - 1] - base) * 128 / 243;
+        WriteLine("[Boot] %9u %+9d  %s", at, s32(at - prev), names[i]);
+    }
+}
@@ -0,0 +1,127 @@
+// BootTimeline.h - Boot stage timestamps shared by the PPC and IOS
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <System/Types.h>
+
+/*
+ * Each stage of a boot, from the LZMA loader stub to LaunchGame, stamped with
+ * the Hollywood timer (243 MHz / 128) into a fixed block of MEM2 that the IOS
+ * reloads leave alone, next to the loader's section save area. The PPC half
+ * and the IOS half are on separate cache lines and each side only writes its
+ * own. The PPC goes through the uncached mirror, IOS flushes after every
+ * stamp. A stamp of zero means the stage didn't run, or ran on the PPC
+ * before it had access to the timer.
+ *
+ * Plain C, so the loader stub can use it too.
+ */
+
+#define BOOT_TIMELINE_MAGIC 0x54494D45 /* TIME */
+#define BOOT_TIMELINE_PHYS 0x11F00000
+
+enum {
+    BOOT_PPC_LOADER_START,
+    BOOT_PPC_LOADER_DECODED,
+    BOOT_PPC_CHANNEL_MAIN,
+    BOOT_PPC_IOS_RELOADED,
+    BOOT_PPC_IOS_LAUNCH,
+    BOOT_PPC_IOS_LAUNCHED,
+    BOOT_PPC_SAOIRSE_OPENED,
+    BOOT_PPC_START_REQUEST,
+    BOOT_PPC_START_DONE,
+    BOOT_PPC_LAUNCH_GAME,
+
+    BOOT_PPC_STAGE_COUNT,
+};
+
+enum {
+    BOOT_IOS_ENTRY,
+    BOOT_IOS_SAOIRSE_READY,
+    BOOT_IOS_BLOB_MOUNTED,
+    BOOT_IOS_LOAD_DOL_START,
+    BOOT_IOS_LOAD_DOL_DONE,
+    BOOT_IOS_NOTIFY_0,
+    BOOT_IOS_NOTIFY_1,
+    BOOT_IOS_NOTIFY_2,
+    BOOT_IOS_NOTIFY_3,
+    BOOT_IOS_NOTIFY_4,
+    BOOT_IOS_LAUNCH_TITLE,
+    BOOT_IOS_MEM1_CLEARED,
+
+    BOOT_IOS_STAGE_COUNT,
+};
+
+typedef struct {
+    // Owned by the PPC
+    u32 magic;
+    u32 ppc[15];
+
+    // Owned by IOS
+    u32 ios[16];
+} BootTimelineData;
+
+#ifndef TARGET_IOS
+
+#define BOOT_TIMELINE                                                          \
+    ((volatile BootTimelineData*)(BOOT_TIMELINE_PHYS | 0xC0000000))
+
+// HW_TIMER and HW_BUSPROT through the uncached mirror of the trusted ACR base
+#define BOOT_TIMELINE_ACR_TIMER 0xCD800010
+#define BOOT_TIMELINE_ACR_BUSPROT 0xCD800064
+#define BOOT_TIMELINE_PPCKERN 0x80000000
+
+/*
+ * The trusted timer can only be read once the PPC has been given ACR access
+ * (ACRBUSPROTBit::PPCKERN), which the loader stub and the channel before its
+ * exploit don't have. Returns zero without it, or the timer, never zero.
+ */
+static inline u32 BootTimelineNow(void)
+{
+    if (!(*(volatile u32*)BOOT_TIMELINE_ACR_BUSPROT & BOOT_TIMELINE_PPCKERN))
+        return 0;
+
+    const u32 now = *(volatile u32*)BOOT_TIMELINE_ACR_TIMER;
+    return now != 0 ? now : 1;
+}
+
+/*
+ * Clear the timeline for a new boot. The loader stub does this, the channel
+ * only does it if the stub didn't run.
+ */
+static inline void BootTimelineReset(void)
+{
+    volatile BootTimelineData* timeline = BOOT_TIMELINE;
+    for (u32 i = 0; i < sizeof(BootTimelineData) / 4; i++)
+        ((volatile u32*)timeline)[i] = 0;
+    timeline->magic = BOOT_TIMELINE_MAGIC;
+}
+
+/*
+ * A stage that runs without ACR access is left unstamped.
+ */
+static inline void BootTimelineStamp(u32 stage)
+{
+    const u32 now = BootTimelineNow();
+    if (now != 0)
+        BOOT_TIMELINE->ppc[stage] = now;
+}
+
+#endif
+
+#ifdef __cplusplus
+
+namespace BootTimeline
+{
+
+#ifdef TARGET_IOS
+void Stamp(u32 stage);
+#endif
+
+// Print every stage in the order it happened, with the time it took
+void Report();
+
+} // namespace BootTimeline
+
+#endif
@@ -31,8 +31,6 @@ static constexpr std::array<char, 3> logChars = {
     'E',
 };
 static Mutex* logMutex;
-constexpr u32 logMask = 0xFFFFFFFF;
-constexpr u32 logLevel = 0;
 
 bool Log::IsEnabled()
 {
@@ -43,8 +41,8 @@ bool Log::IsEnabled()
 #endif
 }
 
-void Log::VPrint(LogSource src, const char* srcStr, const char* funcStr,
-                 LogLevel level, const char* format, va_list args)
+void Log::VPrint(const char* srcStr, const char* funcStr, LogLevel level,
+                 const char* format, va_list args)
 {
     if (!IsEnabled())
         return;
@@ -53,19 +51,9 @@ void Log::VPrint(LogSource src, const char* srcStr, const char* funcStr,
         logMutex = new Mutex;
     }
 
-    if (src == LogSource::IOS_USB)
-        return;
-
     u32 slvl = static_cast<u32>(level);
-    u32 schan = static_cast<u32>(src);
     ASSERT(slvl < logColors.size());
 
-    if (level != LogLevel::ERROR) {
-        if (!(logMask & (1 << schan)))
-            return;
-        if (slvl < logLevel)
-            return;
-    }
     {
         logMutex->lock();
 
@@ -90,9 +78,11 @@ void Log::VPrint(LogSource src, const char* srcStr, const char* funcStr,
             IPCLog::sInstance->Print(&printBuffer[0]);
         }
 
-        if (DeviceMgr::sInstance->IsLogEnabled()) {
+        if (DeviceMgr::sInstance != nullptr &&
+            DeviceMgr::sInstance->IsLogEnabled()) {
             len = snprintf(&printBuffer[0], printBuffer.size(),
-                           "<%llu> %c[%s %s] %s", System::GetTime(),
+                           "<%llu> %c[%s %s] %s",
+                           (unsigned long long)System::GetTime(),
                            logChars[slvl], srcStr, funcStr, logBuffer.data());
             DeviceMgr::sInstance->WriteToLog(&printBuffer[0], len);
         }
@@ -105,11 +95,11 @@ void Log::VPrint(LogSource src, const char* srcStr, const char* funcStr,
     }
 }
 
-void Log::Print(LogSource src, const char* srcStr, const char* funcStr,
-                LogLevel level, const char* format, ...)
+void Log::Print(const char* srcStr, const char* funcStr, LogLevel level,
+                const char* format, ...)
 {
     va_list args;
     va_start(args, format);
-    VPrint(src, srcStr, funcStr, level, format, args);
+    VPrint(srcStr, funcStr, level, format, args);
     va_end(args);
 }
@@ -4,6 +4,7 @@
 // SPDX-License-Identifier: MIT
 
 #pragma once
+#include "LogConfig.hpp"
 #include <stdarg.h>
 #ifdef TARGET_IOS
 #include <FAT/ff.h>
@@ -12,34 +13,20 @@
 namespace Log
 {
 
-enum class LogSource {
-    Core,
-    DVD,
-    Loader,
-    Payload,
-    FST,
-    PatchList,
-    IOS,
-    IOS_Loader,
-    IOS_DevMgr,
-    IOS_USB,
-    IOS_EmuFS,
-    IOS_EmuDI,
-    IOS_EmuES,
-    IOS_EmuSDIO,
-    IOS_EmuHID,
-};
-
 enum class LogLevel {
     INFO,
     WARN,
-    ERROR
+    ERROR,
+    OFF,
 };
 
 enum class IPCLogIoctl {
     RegisterPrintHook,
     StartGameEvent,
     SetTime,
+    RegisterLogRing,
+    WaitLogRing,
+    GetMemReport,
 };
 
 enum class IPCLogReply {
@@ -55,10 +42,10 @@ extern bool ipcLogEnabled;
 
 bool IsEnabled();
 
-void VPrint(LogSource src, const char* srcStr, const char* funcStr,
-            LogLevel level, const char* format, va_list args);
-void Print(LogSource src, const char* srcStr, const char* funcStr,
-           LogLevel level, const char* format, ...);
+void VPrint(const char* srcStr, const char* funcStr, LogLevel level,
+            const char* format, va_list args);
+void Print(const char* srcStr, const char* funcStr, LogLevel level,
+           const char* format, ...);
 
 #ifdef NDEBUG
 
@@ -66,9 +53,17 @@ void Print(LogSource src, const char* srcStr, const char* funcStr,
 
 #else
 
+/*
+ * The channel and level are checked at compile time (see LogConfig.hpp), so a
+ * disabled PRINT emits no call, no string and evaluates none of its arguments.
+ */
 #define PRINT(CHANNEL, LEVEL, ...)                                             \
-    Log::Print(Log::LogSource::CHANNEL, #CHANNEL, __FUNCTION__,                \
-               Log::LogLevel::LEVEL, __VA_ARGS__)
+    do {                                                                       \
+        if constexpr (Log::LogLevel::LEVEL >=                                  \
+                      Log::LogLevel::LOG_LEVEL_##CHANNEL)                      \
+            Log::Print(#CHANNEL, __FUNCTION__, Log::LogLevel::LEVEL,           \
+                       __VA_ARGS__);                                           \
+    } while (0)
 
 #endif
 
@@ -0,0 +1,59 @@
+// LogConfig.hpp - Per-channel debug log configuration
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/*
+ * Lowest level printed for each log channel. Any PRINT below it is removed at
+ * compile time, including its format string and arguments. OFF removes every
+ * message from the channel, errors included. Override from the build with e.g.
+ * make LOG_LEVELS="IOS_EmuSDIO=WARN IOS_USB=INFO", which passes
+ * -DLOG_LEVEL_IOS_EmuSDIO=WARN and so on.
+ */
+
+#ifndef LOG_LEVEL_Core
+#define LOG_LEVEL_Core INFO
+#endif
+#ifndef LOG_LEVEL_DVD
+#define LOG_LEVEL_DVD INFO
+#endif
+#ifndef LOG_LEVEL_Loader
+#define LOG_LEVEL_Loader INFO
+#endif
+#ifndef LOG_LEVEL_Payload
+#define LOG_LEVEL_Payload INFO
+#endif
+#ifndef LOG_LEVEL_FST
+#define LOG_LEVEL_FST INFO
+#endif
+#ifndef LOG_LEVEL_PatchList
+#define LOG_LEVEL_PatchList INFO
+#endif
+#ifndef LOG_LEVEL_IOS
+#define LOG_LEVEL_IOS INFO
+#endif
+#ifndef LOG_LEVEL_IOS_Loader
+#define LOG_LEVEL_IOS_Loader INFO
+#endif
+#ifndef LOG_LEVEL_IOS_DevMgr
+#define LOG_LEVEL_IOS_DevMgr INFO
+#endif
+#ifndef LOG_LEVEL_IOS_USB
+#define LOG_LEVEL_IOS_USB OFF
+#endif
+#ifndef LOG_LEVEL_IOS_EmuFS
+#define LOG_LEVEL_IOS_EmuFS INFO
+#endif
+#ifndef LOG_LEVEL_IOS_EmuDI
+#define LOG_LEVEL_IOS_EmuDI INFO
+#endif
+#ifndef LOG_LEVEL_IOS_EmuES
+#define LOG_LEVEL_IOS_EmuES INFO
+#endif
+#ifndef LOG_LEVEL_IOS_EmuSDIO
+#define LOG_LEVEL_IOS_EmuSDIO INFO
+#endif
+#ifndef LOG_LEVEL_IOS_EmuHID
+#define LOG_LEVEL_IOS_EmuHID INFO
+#endif
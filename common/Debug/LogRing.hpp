@@ -0,0 +1,64 @@
+// LogRing.hpp - Shared memory IOS to PowerPC log ring
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <System/Types.h>
+#include <System/Util.h>
+
+namespace Log
+{
+
+/*
+ * IOS writes IPCLogReadyMagic to this MEM2 word (physical address, part of the
+ * header of the VFile the module was loaded from) once /dev/saoirse is
+ * registered. The PPC clears it before launching and waits for it, instead of
+ * retrying IOS_Open until it stops failing.
+ */
+constexpr u32 IPCLogReadyAddr = 0x1100000C;
+constexpr u32 IPCLogReadyMagic = 0x52454459; /* REDY */
+
+/*
+ * Single producer (IOS), single consumer (PPC) ring buffer, allocated by the
+ * PPC in MEM2 and handed over with IPCLogIoctl::RegisterLogRing. The producer
+ * and consumer fields are on separate cache lines, so each side only ever
+ * writes back the line it owns. Positions are free running byte counters.
+ */
+struct LogRing {
+    static constexpr u32 MAGIC = 0x4C52494E; /* LRIN */
+    static constexpr u32 DataSize = 0x4000;
+    static_assert((DataSize & (DataSize - 1)) == 0);
+
+    // Owned by IOS
+    u32 magic;
+    u32 writePos;
+    u32 dropCount;
+    u32 pad0[8 - 3];
+
+    // Owned by PPC
+    u32 readPos;
+    u32 pad1[8 - 1];
+
+    u8 data[DataSize];
+};
+
+static_assert(sizeof(LogRing) == 64 + LogRing::DataSize);
+
+/*
+ * Ring record header. The payload follows immediately and the whole record is
+ * padded to 4 bytes. Records never wrap; a RingPad record fills the space at
+ * the end of the buffer instead.
+ */
+struct LogRecord {
+    u16 type; // IPCLogReply or RingPad
+    u16 len;
+};
+
+constexpr u16 RingPad = 0xFFFF;
+
+constexpr u32 RecordSize(u32 len)
+{
+    return round_up<u32>(sizeof(LogRecord) + len, 4);
+}
+
+} // namespace Log
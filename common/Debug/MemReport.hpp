@@ -0,0 +1,60 @@
+// MemReport.hpp - IOS memory usage report
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <System/Types.h>
+
+namespace Log
+{
+
+/*
+ * Output of IPCLogIoctl::GetMemReport. Heap sites are tagged with the return
+ * address of the operator new call, look them up in saoirse_ios.map. Site 0
+ * collects everything after the site table filled up. The heap fields are
+ * only filled in by a HEAP_STATS build.
+ */
+struct MemReport {
+    static constexpr u32 MaxSites = 32;
+    static constexpr u32 MaxStacks = 16;
+    static constexpr u32 MaxSlabs = 8;
+
+    struct Site {
+        u32 tag;
+        u32 current;
+        u32 peak;
+        u32 count;
+    };
+
+    struct Stack {
+        s32 threadId;
+        u32 size;
+        u32 used;
+        u32 pad;
+    };
+
+    struct Slab {
+        u32 blockSize;
+        u32 blockCount;
+        u32 peak;
+        u32 fallbackCount;
+    };
+
+    u32 heapSize;
+    u32 heapCurrent;
+    u32 heapPeak;
+    u32 heapCount;
+
+    u32 siteCount;
+    u32 stackCount;
+    u32 slabCount;
+    u32 pad;
+
+    Site sites[MaxSites];
+    Stack stacks[MaxStacks];
+    Slab slabs[MaxSlabs];
+};
+
+static_assert(sizeof(MemReport) % 32 == 0);
+
+} // namespace Log
@@ -7,6 +7,9 @@
 #include <System/OS.hpp>
 #include <System/Types.h>
 #include <System/Util.h>
+#ifdef TARGET_IOS
+#include <System/AESEngine.hpp>
+#endif
 
 class AES
 {
@@ -28,6 +31,14 @@ public:
     s32 Encrypt(const u8* key, u8* iv, const void* input, u32 size,
                 void* output)
     {
+#ifdef TARGET_IOS
+        // Program the engine directly if possible, it saves the IPC round trip
+        const s32 engineRet =
+            AESEngine::Crypt(false, key, iv, input, size, output);
+        if (engineRet != IOSError::NoAccess)
+            return engineRet;
+#endif
+
         IOS::IOVector<2, 2> vec;
         vec.in[0].data = input;
         vec.in[0].len = size;
@@ -46,6 +57,14 @@ public:
     s32 Decrypt(const u8* key, u8* iv, const void* input, u32 size,
                 void* output)
     {
+#ifdef TARGET_IOS
+        // Program the engine directly if possible, it saves the IPC round trip
+        const s32 engineRet =
+            AESEngine::Crypt(true, key, iv, input, size, output);
+        if (engineRet != IOSError::NoAccess)
+            return engineRet;
+#endif
+
         if (size < MaxInputSize) {
             IOS::IOVector<2, 2> vec;
             vec.in[0].data = input;
@@ -65,6 +65,14 @@ enum class ACRSRNPROTBit {
     IOPDBGEN = 0x40,
 };
 
+// Bit fields for PPC_IRQFLAG, ARM_IRQFLAG and their masks
+enum class ACRIRQBit : u32 {
+    TIMER = 0x00000001,
+    NAND = 0x00000002,
+    AES = 0x00000004,
+    SHA = 0x00000008,
+};
+
 // Bit fields for BUSPROT
 enum class ACRBUSPROTBit : u32 {
     // Flash/NAND Engine PPC; Set/cleared by syscall_54
@@ -110,6 +118,54 @@ enum class ACRBUSPROTBit : u32 {
     PPCKERN = 0x80000000,
 };
 
+// AES engine base
+constexpr u32 AES_BASE = 0x0D020000;
+
+// AES engine registers
+enum class AESReg {
+    CTRL = 0x00,
+    SRC = 0x04,
+    DEST = 0x08,
+    // Key and IV are FIFOs, written one word at a time
+    KEY = 0x0C,
+    IV = 0x10,
+};
+
+// Bit fields for AES CTRL; the low 12 bits are the block count minus one
+enum class AESCtrlBit : u32 {
+    // Start the command, cleared by the engine when done
+    EXEC = 0x80000000,
+    IRQ = 0x40000000,
+    ERR = 0x20000000,
+    // Enable encryption, otherwise the data is only copied
+    ENA = 0x10000000,
+    DEC = 0x08000000,
+    // Continue from the IV state of the last command
+    IV = 0x00001000,
+};
+
+// SHA-1 engine base
+constexpr u32 SHA_BASE = 0x0D030000;
+
+// SHA-1 engine registers
+enum class SHAReg {
+    CTRL = 0x00,
+    SRC = 0x04,
+    H0 = 0x08,
+    H1 = 0x0C,
+    H2 = 0x10,
+    H3 = 0x14,
+    H4 = 0x18,
+};
+
+// Bit fields for SHA CTRL; the low 10 bits are the block count minus one
+enum class SHACtrlBit : u32 {
+    // Start the command, cleared by the engine when done
+    EXEC = 0x80000000,
+    IRQ = 0x40000000,
+    ERR = 0x20000000,
+};
+
 // GPIO pin connections
 enum class GPIOPin {
     POWER = 0x000001,
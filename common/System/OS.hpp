@@ -9,6 +9,9 @@
 #ifdef TARGET_IOS
 #include <IOS/Syscalls.h>
 #include <IOS/System.hpp>
+#include <IOS/TimerMgr.hpp>
+#include <System/MemStats.hpp>
+#include <System/Slab.hpp>
 #else
 LIBOGC_SUCKS_BEGIN
 #include <ogc/ipc.h>
@@ -23,7 +26,11 @@ LIBOGC_SUCKS_END
 #define DASSERT assert
 #define ASSERT assert
 
-#ifdef TARGET_IOS
+#if defined(TARGET_HOST)
+// PPC memory is a plain buffer in the host build
+extern u8 g_hostMEM1[];
+#define MEM1_BASE ((void*)g_hostMEM1)
+#elif defined(TARGET_IOS)
 #define MEM1_BASE ((void*)0x00000000)
 #else
 #define MEM1_BASE ((void*)0x80000000)
@@ -61,14 +68,14 @@ enum {
 template <typename T>
 class IOS_Queue
 {
-    static_assert(sizeof(T) == 4, "T must be equal to 4 bytes");
+    static_assert(sizeof(T) <= sizeof(IOSMessage), "T must fit in a message");
 
 public:
     IOS_Queue(const IOS_Queue& from) = delete;
 
     explicit IOS_Queue(u32 count = 8)
     {
-        this->m_base = new u32[count];
+        this->m_base = new IOSMessage[count];
         const s32 ret = IOS_CreateMessageQueue(this->m_base, count);
         this->m_queue = ret;
         ASSERT(ret >= 0);
@@ -83,16 +90,40 @@ public:
 
     void send(T msg, u32 flags = 0)
     {
-        const s32 ret = IOS_SendMessage(this->m_queue, (u32)(msg), flags);
+        const s32 ret =
+            IOS_SendMessage(this->m_queue, (IOSMessage)(msg), flags);
         ASSERT(ret == IOSError::OK);
     }
 
     T receive(u32 flags = 0)
     {
-        T msg;
-        const s32 ret = IOS_ReceiveMessage(this->m_queue, (u32*)(&msg), flags);
+        IOSMessage msg;
+        s32 ret;
+        while (true) {
+            ret = IOS_ReceiveMessage(this->m_queue, &msg, flags);
+            if (ret != IOSError::OK || this->m_staleTimeouts == 0 ||
+                msg != timeoutToken())
+                break;
+            this->m_staleTimeouts--;
+        }
         ASSERT(ret == IOSError::OK);
-        return reinterpret_cast<T>(msg);
+        return (T)(msg);
+    }
+
+    /*
+     * Receive with a timeout in microseconds. Returns false if the timeout
+     * expired first. Only one thread may wait on a queue with a timeout.
+     */
+    bool receive(T& msg, u32 usec)
+    {
+        IOSMessage raw;
+        if (!TimerMgr::sInstance->Receive(this->m_queue, &raw, usec,
+                                          &this->m_staleTimeouts,
+                                          timeoutToken()))
+            return false;
+
+        msg = (T)(raw);
+        return true;
     }
 
     s32 id() const
@@ -101,8 +132,15 @@ public:
     }
 
 private:
-    u32* m_base;
+    // Never a valid message, as it points to this object
+    IOSMessage timeoutToken() const
+    {
+        return reinterpret_cast<IOSMessage>(this);
+    }
+
+    IOSMessage* m_base;
     s32 m_queue;
+    u32 m_staleTimeouts = 0;
 };
 
 template <typename T>
@@ -166,6 +204,51 @@ using Queue = LibOGC_Queue<T>;
 
 #endif
 
+#ifdef TARGET_IOS
+
+/*
+ * Futex-style mutex. Taking or releasing an uncontended lock is a single SWP,
+ * the queue is only used to sleep and wake threads on contention.
+ */
+class Mutex
+{
+public:
+    Mutex(const Mutex& from) = delete;
+
+    Mutex() : m_state(Unlocked), m_queue(1)
+    {
+    }
+
+    void lock()
+    {
+        if (AtomicSwap(&m_state, Locked) == Unlocked)
+            return;
+
+        // Assume there are other waiters, as we can't know otherwise
+        while (AtomicSwap(&m_state, Contended) != Unlocked)
+            m_queue.receive();
+    }
+
+    void unlock()
+    {
+        // A full queue already has a wakeup pending, so don't block on it
+        if (AtomicSwap(&m_state, Unlocked) == Contended)
+            IOS_SendMessage(m_queue.id(), 0, 1);
+    }
+
+protected:
+    enum : u32 {
+        Unlocked = 0,
+        Locked = 1,
+        Contended = 2,
+    };
+
+    volatile u32 m_state;
+    Queue<u32> m_queue;
+};
+
+#else
+
 class Mutex
 {
 public:
@@ -190,6 +273,8 @@ protected:
     Queue<u32> m_queue;
 };
 
+#endif
+
 #ifdef TARGET_IOS
 
 class IOS_Thread
@@ -244,6 +329,7 @@ public:
             m_ownedStack = stack;
         }
         u32* stackTop = reinterpret_cast<u32*>(stack + stackSize);
+        MemStats::PaintStack(stack, stackSize);
 
         m_ret = IOS_CreateThread(__threadProc, reinterpret_cast<void*>(this),
                                  stackTop, stackSize, prio, true);
@@ -251,6 +337,7 @@ public:
             return;
 
         m_tid = m_ret;
+        MemStats::RegisterStack(m_tid, stack, stackSize);
         m_ret = IOS_StartThread(m_tid);
         if (m_ret < 0)
             return;
@@ -362,16 +449,17 @@ static inline void Free(void* ptr);
 
 constexpr s32 ipcHeap = 0;
 
+// Small requests are served from the IPC slab pools.
 static inline void* Alloc(u32 size)
 {
-    void* ptr = IOS_AllocAligned(ipcHeap, round_up(size, 32), 32);
+    void* ptr = Slab::Alloc(size, Slab::Heap::IPC);
     ASSERT(ptr);
     return ptr;
 }
 
 static inline void Free(void* ptr)
 {
-    s32 ret = IOS_Free(ipcHeap, ptr);
+    s32 ret = Slab::Free(ptr, Slab::Heap::IPC);
     ASSERT(ret == IOSError::OK);
 }
 
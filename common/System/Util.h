@@ -50,28 +50,29 @@
     }
 
 #ifdef __cplusplus
+#include <cstddef>
+
+// Through size_t, so pointers aren't truncated in the 64-bit host build
 template <typename T>
 constexpr T round_up(T num, unsigned int align)
 {
-    u32 raw = (u32)num;
-    return (T)((raw + align - 1) & -align);
+    size_t raw = (size_t)num;
+    return (T)((raw + align - 1) & ~size_t(align - 1));
 }
 
 template <typename T>
 constexpr T round_down(T num, unsigned int align)
 {
-    u32 raw = (u32)num;
-    return (T)(raw & -align);
+    size_t raw = (size_t)num;
+    return (T)(raw & ~size_t(align - 1));
 }
 
 template <class T>
 constexpr bool aligned(T addr, unsigned int align)
 {
-    return !((u32)addr & (align - 1));
+    return !((size_t)addr & (align - 1));
 }
 
-#include <cstddef>
-
 template <class T1, class T2>
 constexpr bool check_bounds(T1 bounds, size_t bound_len, T2 buffer, size_t len)
 {
@@ -141,62 +142,85 @@ static inline u16 bswap16(u16 val)
     return ((val & 0xFF) << 8) | ((val & 0xFF00) >> 8);
 }
 
-static inline u32 _read8(u32 address)
+#ifdef TARGET_HOST
+EXTERN_C_START
+// Hollywood registers are modelled in host/IOS/MMIO.cpp
+u32 HostMMIORead32(uintptr_t address);
+void HostMMIOWrite32(uintptr_t address, u32 value);
+EXTERN_C_END
+
+static inline bool HostIsMMIO(uintptr_t address)
+{
+    return (address >> 24) == 0x0D;
+}
+#endif
+
+static inline u32 _read8(uintptr_t address)
 {
     return *(vu8*)address;
 }
 
-static inline u32 _read16(u32 address)
+static inline u32 _read16(uintptr_t address)
 {
     return *(vu16*)address;
 }
 
-static inline u32 _read32(u32 address)
+static inline u32 _read32(uintptr_t address)
 {
+#ifdef TARGET_HOST
+    if (HostIsMMIO(address))
+        return HostMMIORead32(address);
+#endif
     return *(vu32*)address;
 }
 
-static inline void _write8(u32 address, u8 value)
+static inline void _write8(uintptr_t address, u8 value)
 {
     *(vu8*)address = value;
 }
 
-static inline void _write16(u32 address, u16 value)
+static inline void _write16(uintptr_t address, u16 value)
 {
     *(vu16*)address = value;
 }
 
-static inline void _write32(u32 address, u32 value)
+static inline void _write32(uintptr_t address, u32 value)
 {
+#ifdef TARGET_HOST
+    if (HostIsMMIO(address)) {
+        HostMMIOWrite32(address, value);
+        return;
+    }
+#endif
     *(vu32*)address = value;
 }
 
-static inline void _mask32(u32 address, u32 clear, u32 set)
+static inline void _mask32(uintptr_t address, u32 clear, u32 set)
 {
     *(vu32*)address = ((*(vu32*)address) & ~clear) | set;
 }
 
-#define write8(_ADDRESS, _VALUE) _write8((u32)(_ADDRESS), (u8)(_VALUE))
-#define write16(_ADDRESS, _VALUE) _write16((u32)(_ADDRESS), (u16)(_VALUE))
-#define write32(_ADDRESS, _VALUE) _write32((u32)(_ADDRESS), (u32)(_VALUE))
-#define read8(_ADDRESS) _read8((u32)(_ADDRESS))
-#define read16(_ADDRESS) _read16((u32)(_ADDRESS))
-#define read32(_ADDRESS) _read32((u32)(_ADDRESS))
+#define write8(_ADDRESS, _VALUE) _write8((uintptr_t)(_ADDRESS), (u8)(_VALUE))
+#define write16(_ADDRESS, _VALUE) _write16((uintptr_t)(_ADDRESS), (u16)(_VALUE))
+#define write32(_ADDRESS, _VALUE) _write32((uintptr_t)(_ADDRESS), (u32)(_VALUE))
+#define read8(_ADDRESS) _read8((uintptr_t)(_ADDRESS))
+#define read16(_ADDRESS) _read16((uintptr_t)(_ADDRESS))
+#define read32(_ADDRESS) _read32((uintptr_t)(_ADDRESS))
 
 #define mask32(_ADDRESS, _CLEAR, _SET)                                         \
-    _mask32((u32)(_ADDRESS), (u32)(_CLEAR), (u32)(_SET))
+    _mask32((uintptr_t)(_ADDRESS), (u32)(_CLEAR), (u32)(_SET))
 
 #endif
 
-#define read16_le(_ADDRESS) bswap16(read16((u32)(_ADDRESS)))
-#define read32_le(_ADDRESS) bswap32(read32((u32)(_ADDRESS)))
+#define read16_le(_ADDRESS) bswap16(read16((uintptr_t)(_ADDRESS)))
+#define read32_le(_ADDRESS) bswap32(read32((uintptr_t)(_ADDRESS)))
 #define write16_le(_ADDRESS, _VALUE)                                           \
-    write16((u32)(_ADDRESS), bswap16((u16)(_VALUE)))
+    write16((uintptr_t)(_ADDRESS), bswap16((u16)(_VALUE)))
 #define write32_le(_ADDRESS, _VALUE)                                           \
-    write32((u32)(_ADDRESS), bswap32((u32)(_VALUE)))
+    write32((uintptr_t)(_ADDRESS), bswap32((u32)(_VALUE)))
 
 // libogc doesn't have this for some reason?
-static inline void mask16(u32 address, u16 clear, u16 set)
+static inline void mask16(uintptr_t address, u16 clear, u16 set)
 {
     *(vu16*)address = ((*(vu16*)address) & ~clear) | set;
 }
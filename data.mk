@@ -25,11 +25,25 @@ DUMMY != mkdir -p $(BIN)
 OUTPUT		:=  $(BIN)/$(TARGET)
 DATAFILES := $(foreach dir,$(DATA),$(wildcard $(dir)/*))
 
+# make COMPRESS_IOS=1 packs the IOS module LZ4 compressed, see
+# ios/Loader/compress.py. Off until the channel DOL size and the loader's decode
+# time have been measured both ways.
+COMPRESS_IOS ?= 0
+ifeq ($(COMPRESS_IOS),1)
+IOS_MODULE	:=	$(BIN)/saoirse_ios.elf.lz4
+else
+IOS_MODULE	:=	$(BIN)/saoirse_ios.elf
+endif
+
 default: $(OUTPUT)
 
-$(OUTPUT): $(DATAFILES) $(BIN)/saoirse_ios.elf $(BIN)/ios_loader.bin
+$(OUTPUT): $(DATAFILES) $(IOS_MODULE) $(BIN)/ios_loader.bin
 	@rm -rf $@
 	@echo packing ... $(notdir $@)
-	@$(AR) -r $@ $(DATAFILES) $(BIN)/saoirse_ios.elf $(BIN)/ios_loader.bin
+	@$(AR) -r $@ $(DATAFILES) $(IOS_MODULE) $(BIN)/ios_loader.bin
+
+$(BIN)/saoirse_ios.elf.lz4: $(BIN)/saoirse_ios.elf ios/Loader/compress.py
+	@echo compressing ... $(notdir $@)
+	@python ios/Loader/compress.py $< $@
 
 
@@ -0,0 +1,93 @@
+#---------------------------------------------------------------------------------
+# Host (Linux) build of the IOS storage stack, for profiling and debugging
+# with native tools. Hardware drivers are replaced by the versions in host/,
+# see host/IOS/Syscalls.cpp.
+#---------------------------------------------------------------------------------
+.SUFFIXES:
+
+#---------------------------------------------------------------------------------
+# TARGET is the name of the output
+# BUILD is the directory where object files & intermediate files will be placed
+# INCLUDES is a list of directories containing extra header files
+#---------------------------------------------------------------------------------
+TARGET		:=	saoirse_host
+BUILD		:=	build_host
+INCLUDES	:=	host ios common
+BIN			:=	bin
+
+#---------------------------------------------------------------------------------
+# Sources shared with the IOS module. Anything that touches hardware has a
+# replacement in host/ instead, or goes through the register model in
+# host/IOS/MMIO.cpp.
+#---------------------------------------------------------------------------------
+IOS_CFILES	:=	ios/FAT/ff.c ios/FAT/ffunicode.c
+IOS_CPPFILES	:=	ios/CTGP/Blob.cpp \
+					ios/Disk/DeviceMgr.cpp \
+					ios/Disk/FatFS.cpp \
+					ios/Disk/StorageBench.cpp \
+					ios/EmuSDIO/EmuSDIO.cpp \
+					ios/System/AESEngine.cpp \
+					ios/System/Config.cpp \
+					ios/System/MemStats.cpp \
+					ios/System/SHAEngine.cpp \
+					ios/System/Slab.cpp \
+					common/Debug/BootTimeline.cpp \
+					common/Debug/Log.cpp \
+					common/System/AES.cpp \
+					common/System/SHA.cpp
+
+HOST_CPPFILES	:=	$(wildcard host/*.cpp) $(wildcard host/*/*.cpp)
+
+CFILES		:=	$(IOS_CFILES)
+CPPFILES	:=	$(IOS_CPPFILES) $(HOST_CPPFILES)
+
+OFILES		:=	$(CPPFILES:.cpp=_cpp.o) $(CFILES:.c=_c.o)
+OFILES		:=	$(addprefix $(BUILD)/, $(OFILES))
+
+DEPENDS		:=	$(addsuffix .d, $(basename $(OFILES)))
+
+DUMMY != mkdir -p $(BIN) $(sort $(dir $(OFILES)))
+
+OUTPUT		:=	$(BIN)/$(TARGET)
+
+#---------------------------------------------------------------------------------
+# options for code generation
+#---------------------------------------------------------------------------------
+CC			:=	gcc
+CXX			:=	g++
+
+INCLUDE		:=	$(foreach dir,$(INCLUDES),-I$(dir))
+
+# Native by default, ARCH=-m32 also works where 32-bit libraries exist.
+# IOS messages are widened to hold a pointer, see IOSMessage. Not -Werror,
+# as host compilers warn about different things than devkitARM.
+ARCH		?=
+
+CFLAGS	:=	$(ARCH) $(INCLUDE) -O2 -g -DTARGET_IOS -DTARGET_HOST -DNDEBUG -DSTORAGE_BENCH -DSDIO_TRACE -DHEAP_STATS -DDOL_CACHE -D_FILE_OFFSET_BITS=64 \
+	-Wall -Wextra -Wno-unused-parameter -Wno-unused-const-variable -Wno-unused-function -Wno-unused-variable \
+	-Wno-unused-but-set-variable -Wno-pointer-arith -Wno-format-truncation -fno-omit-frame-pointer -fno-exceptions -pthread
+CXXFLAGS = $(CFLAGS) -std=c++20 -fno-rtti -Wno-narrowing
+
+# Not PIE, so MEM1 in .bss stays below 0x80000000
+LDFLAGS	=	$(ARCH) -no-pie -pthread
+
+
+default: $(OUTPUT)
+
+clean:
+	@echo cleaning...
+	@rm -rf $(OUTPUT) $(BUILD)
+
+$(OUTPUT): $(OFILES)
+	@echo linking ... $(notdir $@)
+	@$(CXX) -o $@ $(OFILES) $(LDFLAGS)
+
+$(BUILD)/%_cpp.o : %.cpp
+	@echo $(notdir $<)
+	@$(CXX) -MMD -MF $(BUILD)/$*_cpp.d $(CXXFLAGS) -c $< -o$@
+
+$(BUILD)/%_c.o : %.c
+	@echo $(notdir $<)
+	@$(CC) -MMD -MF $(BUILD)/$*_c.d $(CFLAGS) -c $< -o$@
+
+-include $(DEPENDS)
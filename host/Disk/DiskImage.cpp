@@ -0,0 +1,91 @@
+// DiskImage.cpp - Disk image files backing the host storage devices
+//
+// SPDX-License-Identifier: MIT
+
+#include "DiskImage.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+DiskImage DiskImage::s_sdImage;
+DiskImage DiskImage::s_usbImages[MaxUSBImages];
+u32 DiskImage::s_usbImageCount = 0;
+u64 DiskImage::s_ioUsec = 0;
+
+static u64 GetUsec()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return u64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * Open an image file, read only if it can't be written to.
+ */
+bool DiskImage::Open(const char* path)
+{
+    Close();
+
+    m_readOnly = false;
+    m_fd = open(path, O_RDWR);
+    if (m_fd < 0) {
+        m_readOnly = true;
+        m_fd = open(path, O_RDONLY);
+    }
+
+    if (m_fd < 0) {
+        perror(path);
+        return false;
+    }
+
+    return true;
+}
+
+void DiskImage::Close()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+    m_fd = -1;
+}
+
+bool DiskImage::Read(u32 sector, u32 count, void* data)
+{
+    const size_t len = size_t(count) * SectorSize;
+    const off_t offset = off_t(sector) * SectorSize;
+
+    if (m_fd < 0)
+        return false;
+
+    const u64 start = GetUsec();
+    const ssize_t ret = pread(m_fd, data, len, offset);
+    s_ioUsec += GetUsec() - start;
+    if (ret < 0)
+        return false;
+
+    // Reads past the end of the image return zeroes
+    if (size_t(ret) < len)
+        memset(reinterpret_cast<u8*>(data) + ret, 0, len - ret);
+
+    return true;
+}
+
+bool DiskImage::Write(u32 sector, u32 count, const void* data)
+{
+    const size_t len = size_t(count) * SectorSize;
+    const off_t offset = off_t(sector) * SectorSize;
+
+    if (m_fd < 0 || m_readOnly)
+        return false;
+
+    const u64 start = GetUsec();
+    const ssize_t ret = pwrite(m_fd, data, len, offset);
+    s_ioUsec += GetUsec() - start;
+    return ret == ssize_t(len);
+}
+
+bool DiskImage::Sync()
+{
+    return m_fd >= 0 && (m_readOnly || fsync(m_fd) == 0);
+}
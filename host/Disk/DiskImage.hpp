@@ -0,0 +1,38 @@
+// DiskImage.hpp - Disk image files backing the host storage devices
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <System/Types.h>
+
+class DiskImage
+{
+public:
+    static constexpr u32 SectorSize = 512;
+    static constexpr u32 MaxUSBImages = 8;
+
+    // The SD card slot, and the USB mass storage devices in attach order
+    static DiskImage s_sdImage;
+    static DiskImage s_usbImages[MaxUSBImages];
+    static u32 s_usbImageCount;
+
+    // Time spent in file I/O across all images, for TraceReplay
+    static u64 s_ioUsec;
+
+    bool Open(const char* path);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return m_fd >= 0;
+    }
+
+    bool Read(u32 sector, u32 count, void* data);
+    bool Write(u32 sector, u32 count, const void* data);
+    bool Sync();
+
+private:
+    int m_fd = -1;
+    bool m_readOnly = false;
+};
@@ -0,0 +1,60 @@
+// SDCard.cpp - Wii SD Card slot I/O, host build
+//
+// SPDX-License-Identifier: MIT
+
+#include "DiskImage.hpp"
+#include <Disk/SDCard.hpp>
+#include <IOS/Syscalls.h>
+
+/*
+ * The card is inserted for as long as an SD image is open. Addresses are in
+ * sectors like an SDHC card.
+ */
+
+bool SDCard::Open()
+{
+    return DiskImage::s_sdImage.IsOpen();
+}
+
+bool SDCard::Startup()
+{
+    return DiskImage::s_sdImage.IsOpen();
+}
+
+bool SDCard::Shutdown()
+{
+    return true;
+}
+
+s32 SDCard::ReadSectors(sec_t sector, sec_t numSectors, void* buffer)
+{
+    if (buffer == nullptr)
+        return -1;
+
+    return DiskImage::s_sdImage.Read(sector, numSectors, buffer) ? IOS_SUCCESS
+                                                                 : IOS_EIO;
+}
+
+s32 SDCard::WriteSectors(sec_t sector, sec_t numSectors, const void* buffer)
+{
+    if (buffer == nullptr)
+        return -1;
+
+    return DiskImage::s_sdImage.Write(sector, numSectors, buffer) ? IOS_SUCCESS
+                                                                  : IOS_EIO;
+}
+
+bool SDCard::ClearStatus()
+{
+    return true;
+}
+
+bool SDCard::IsInserted()
+{
+    return DiskImage::s_sdImage.IsOpen();
+}
+
+bool SDCard::IsInitialized()
+{
+    return DiskImage::s_sdImage.IsOpen();
+}
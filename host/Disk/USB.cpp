@@ -0,0 +1,99 @@
+// USB.cpp - USB2 Device I/O, host build
+//
+// SPDX-License-Identifier: MIT
+
+#include "DiskImage.hpp"
+#include <Disk/USB.hpp>
+#include <cstring>
+
+/*
+ * Every USB image shows up as a bulk-only mass storage device when the first
+ * device change is requested, and stays attached. Device IDs are the image
+ * index plus one.
+ */
+
+USB* USB::sInstance = nullptr;
+
+USB::USB(s32 id)
+{
+}
+
+bool USB::Init()
+{
+    return true;
+}
+
+bool USB::EnqueueDeviceChange(DeviceEntry* devices, Queue<IOS::Request*>* queue,
+                              IOS::Request* req)
+{
+    // Nothing changes after the first report, so never reply again
+    if (m_reqSent)
+        return true;
+    m_reqSent = true;
+
+    for (u32 i = 0; i < DiskImage::s_usbImageCount; i++) {
+        devices[i] = {
+            .devId = i + 1,
+            .vid = 0,
+            .pid = 0,
+            .devNum2 = 0,
+            .ifNum = 0,
+            .altSetCount = 1,
+        };
+    }
+
+    req->cmd = IOS::Command::Reply;
+    req->result = DiskImage::s_usbImageCount;
+    queue->send(req);
+    return true;
+}
+
+USB::USBError USB::GetDeviceInfo(u32 devId, DeviceInfo* outInfo, u8 alt)
+{
+    if (devId == 0 || devId > DiskImage::s_usbImageCount || alt != 0)
+        return USBError::Invalid;
+
+    memset(outInfo, 0, sizeof(DeviceInfo));
+    outInfo->devId = devId;
+    outInfo->interface.ifClass = ClassCode::MassStorage;
+    outInfo->interface.ifSubClass = SubClass::MassStorage_SCSI;
+    outInfo->interface.ifProtocol = Protocol::MassStorage_BulkOnly;
+    return USBError::OK;
+}
+
+USB::USBError USB::Attach(u32 devId)
+{
+    return USBError::OK;
+}
+
+USB::USBError USB::Release(u32 devId)
+{
+    return USBError::OK;
+}
+
+USB::USBError USB::AttachFinish()
+{
+    return USBError::OK;
+}
+
+USB::USBError USB::SuspendResume(u32 devId, State state)
+{
+    return USBError::OK;
+}
+
+USB::USBError USB::CancelEndpoint(u32 devId, u8 endpoint)
+{
+    return USBError::OK;
+}
+
+USB::USBError USB::CtrlMsg(u32 devId, u8 requestType, u8 request, u16 value,
+                           u16 index, u16 length, void* data)
+{
+    return USBError::Invalid;
+}
+
+USB::USBError USB::IntrBulkMsg(u32 devId, USBv5Ioctl ioctl, u8 endpoint,
+                               u16 length, void* data)
+{
+    return USBError::Invalid;
+}
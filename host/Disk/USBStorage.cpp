@@ -0,0 +1,57 @@
+// USBStorage.cpp - USB mass storage, host build
+//
+// SPDX-License-Identifier: MIT
+
+#include "DiskImage.hpp"
+#include <Disk/USBStorage.hpp>
+
+/*
+ * Sector I/O goes straight to the image for the device ID, see USB.cpp.
+ */
+
+USBStorage::USBStorage(USB* usb, USB::DeviceInfo info)
+{
+    m_buffer = nullptr;
+    m_usb = usb;
+    m_info = info;
+}
+
+static DiskImage* GetImage(u32 devId)
+{
+    if (devId == 0 || devId > DiskImage::s_usbImageCount)
+        return nullptr;
+
+    return &DiskImage::s_usbImages[devId - 1];
+}
+
+bool USBStorage::Init()
+{
+    m_id = m_info.devId;
+    m_lun = 0;
+    m_blockSize = DiskImage::SectorSize;
+
+    DiskImage* image = GetImage(m_id);
+    m_valid = image != nullptr && image->IsOpen();
+    return m_valid;
+}
+
+u32 USBStorage::SectorSize()
+{
+    return m_blockSize;
+}
+
+bool USBStorage::ReadSectors(u32 firstSector, u32 sectorCount, void* buffer)
+{
+    return m_valid && GetImage(m_id)->Read(firstSector, sectorCount, buffer);
+}
+
+bool USBStorage::WriteSectors(u32 firstSector, u32 sectorCount,
+                              const void* buffer)
+{
+    return m_valid && GetImage(m_id)->Write(firstSector, sectorCount, buffer);
+}
+
+bool USBStorage::Sync()
+{
+    return m_valid && GetImage(m_id)->Sync();
+}
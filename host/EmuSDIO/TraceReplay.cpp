@@ -0,0 +1,216 @@
+// TraceReplay.cpp - Replays an EmuSDIO access trace, host build
+//
+// SPDX-License-Identifier: MIT
+
+#include "TraceReplay.hpp"
+#include <Disk/DiskImage.hpp>
+#include <EmuSDIO/SDIOTrace.hpp>
+#include <IOS/Syscalls.h>
+#include <algorithm>
+#include <cstdio>
+#include <time.h>
+#include <vector>
+
+/*
+ * The host build defines SDIO_TRACE, but rather than recording, the EmuSDIO
+ * hooks measure how long DeviceMgr takes so it can be told apart from IPC and
+ * the disk image.
+ */
+
+static u64 GetUsec()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return u64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static u64 s_deviceUsec = 0;
+
+void SDIOTrace::Open(u32 devId)
+{
+}
+
+u32 SDIOTrace::Begin()
+{
+    return GetUsec();
+}
+
+void SDIOTrace::End(u32 cmd, u32 sector, u32 count, bool ok, u32 start)
+{
+    s_deviceUsec += u32(GetUsec()) - start;
+}
+
+namespace TraceReplay
+{
+
+enum class SDIOCommand : u32 {
+    ReadMultiBlock = 0x12,
+    WriteMultiBlock = 0x19,
+};
+
+constexpr u32 SendCmd = 0x07;
+constexpr u32 SectorSize = 512;
+constexpr u32 MaxSectors = 2048;
+
+// Same layout as the PPC sends
+struct SDIORequest {
+    SDIOCommand cmd;
+    u32 cmdType;
+    u32 rspType;
+    u32 arg;
+    u32 blkCnt;
+    u32 blkSize;
+    u32 addr;
+    u32 isDMA;
+    u32 pad0;
+};
+
+static_assert(sizeof(SDIORequest) == 0x24);
+
+// In .bss like the emulated MEM1, EmuSDIO masks the address
+static u8 s_buffer[MaxSectors * SectorSize] ATTRIBUTE_ALIGN(32);
+
+static u32 ReadBE32(const u8* data)
+{
+    return (u32(data[0]) << 24) | (u32(data[1]) << 16) | (u32(data[2]) << 8) |
+           data[3];
+}
+
+static bool SendCommand(s32 fd, SDIOCommand cmd, u32 sector, u32 count)
+{
+    SDIORequest req ATTRIBUTE_ALIGN(32) = {
+        .cmd = cmd,
+        .cmdType = 3,
+        .rspType = 1,
+        .arg = sector,
+        .blkCnt = count,
+        .blkSize = SectorSize,
+        .addr = u32(uintptr_t(s_buffer)),
+        .isDMA = 1,
+        .pad0 = 0,
+    };
+    u32 reply[4] ATTRIBUTE_ALIGN(32) = {};
+
+    IOVector vec[3] = {
+        {&req, sizeof(req)},
+        {s_buffer, count * SectorSize},
+        {reply, sizeof(reply)},
+    };
+
+    return IOS_Ioctlv(fd, SendCmd, 2, 1, vec) == IOS_SUCCESS;
+}
+
+struct Totals {
+    u32 count = 0;
+    u32 failed = 0;
+    u64 sectors = 0;
+    u64 totalUsec = 0;
+    u64 deviceUsec = 0;
+    u64 imageUsec = 0;
+    u64 recordedUsec = 0;
+    std::vector<u32> latency;
+};
+
+static void PrintTotals(const char* name, Totals& totals)
+{
+    if (totals.count == 0)
+        return;
+
+    std::sort(totals.latency.begin(), totals.latency.end());
+    const u32 p50 = totals.latency[(totals.latency.size() - 1) * 50 / 100];
+    const u32 p99 = totals.latency[(totals.latency.size() - 1) * 99 / 100];
+
+    printf("%s: %u commands, %u failed, %u KiB\n", name, totals.count,
+           totals.failed, u32(totals.sectors * SectorSize / 1024));
+    printf("  IPC and EmuSDIO   %10u us\n",
+           u32(totals.totalUsec - totals.deviceUsec));
+    printf("  DeviceMgr         %10u us\n",
+           u32(totals.deviceUsec - totals.imageUsec));
+    printf("  Disk image I/O    %10u us\n", u32(totals.imageUsec));
+    printf("  Total             %10u us, p50 %u us, p99 %u us\n",
+           u32(totals.totalUsec), p50, p99);
+    printf("  Recorded on console %8u us\n", u32(totals.recordedUsec));
+}
+
+bool Run(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        perror(path);
+        return false;
+    }
+
+    std::vector<u8> trace(SDIOTrace::FileSize);
+    trace.resize(fread(trace.data(), 1, trace.size(), file));
+    fclose(file);
+
+    if (trace.size() < SectorSize ||
+        ReadBE32(&trace[0]) != SDIOTrace::Magic ||
+        ReadBE32(&trace[4]) != SDIOTrace::Version ||
+        ReadBE32(&trace[8]) != sizeof(SDIOTrace::Record)) {
+        fprintf(stderr, "%s: not an SDIO trace\n", path);
+        return false;
+    }
+
+    const u32 recordCount =
+        std::min<u32>(ReadBE32(&trace[12]), (trace.size() - SectorSize) /
+                                                sizeof(SDIOTrace::Record));
+
+    const s32 fd = IOS_Open("~dev/sdio/slot0", 0);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open EmuSDIO: %d\n", fd);
+        return false;
+    }
+
+    Totals reads, writes;
+    u32 skipped = 0;
+
+    for (u32 i = 0; i < recordCount; i++) {
+        const u8* record = &trace[SectorSize + i * sizeof(SDIOTrace::Record)];
+        const u32 sector = ReadBE32(record + 4);
+        const u32 cmdCount = ReadBE32(record + 8);
+        const u32 duration = ReadBE32(record + 12);
+
+        const SDIOCommand cmd = SDIOCommand(cmdCount >> 24);
+        const u32 count = cmdCount & 0xFFFFFF;
+
+        if (count == 0 || count > MaxSectors ||
+            (cmd != SDIOCommand::ReadMultiBlock &&
+             cmd != SDIOCommand::WriteMultiBlock)) {
+            skipped++;
+            continue;
+        }
+
+        // Write back what's already there, so replaying leaves the image as
+        // it was
+        if (cmd == SDIOCommand::WriteMultiBlock)
+            SendCommand(fd, SDIOCommand::ReadMultiBlock, sector, count);
+
+        const u64 deviceStart = s_deviceUsec;
+        const u64 imageStart = DiskImage::s_ioUsec;
+        const u64 start = GetUsec();
+        const bool ok = SendCommand(fd, cmd, sector, count);
+        const u64 usec = GetUsec() - start;
+
+        Totals& totals =
+            cmd == SDIOCommand::ReadMultiBlock ? reads : writes;
+        totals.count++;
+        totals.failed += !ok;
+        totals.sectors += count;
+        totals.totalUsec += usec;
+        totals.deviceUsec += s_deviceUsec - deviceStart;
+        totals.imageUsec += DiskImage::s_ioUsec - imageStart;
+        totals.recordedUsec += duration & ~SDIOTrace::DurationFailed;
+        totals.latency.push_back(usec);
+    }
+
+    IOS_Close(fd);
+
+    printf("Replayed %u records from %s, skipped %u\n", recordCount - skipped,
+           path, skipped);
+    PrintTotals("Reads", reads);
+    PrintTotals("Writes", writes);
+    return true;
+}
+
+} // namespace TraceReplay
@@ -0,0 +1,17 @@
+// TraceReplay.hpp - Replays an EmuSDIO access trace, host build
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/*
+ * Sends each command of a trace recorded by SDIOTrace to EmuSDIO through IPC,
+ * like the PPC would, and reports where the time went. Must be run after the
+ * channel is loaded, when EmuSDIO is serving the device.
+ */
+namespace TraceReplay
+{
+
+bool Run(const char* path);
+
+} // namespace TraceReplay
@@ -0,0 +1,345 @@
+// Crypto.cpp - Software /dev/aes and /dev/sha for the host build
+//
+// SPDX-License-Identifier: MIT
+
+#include "Crypto.hpp"
+#include <cstring>
+
+namespace Crypto
+{
+
+enum class AESIoctl {
+    Encrypt = 2,
+    Decrypt = 3,
+};
+
+enum class SHAIoctl {
+    Init = 0,
+    Update = 1,
+    Final = 2,
+};
+
+/*
+ * Plain byte oriented AES-128. The tables are generated on first use rather
+ * than written out, which keeps this short and obviously correct; the speed
+ * of this file doesn't matter for what the host build measures.
+ */
+struct AESTables {
+    u8 sbox[256];
+    u8 invSbox[256];
+    u8 mul[15][256];
+
+    static u8 Mul(u8 x, u8 y)
+    {
+        u8 ret = 0;
+        while (y != 0) {
+            if (y & 1)
+                ret ^= x;
+            x = (x << 1) ^ ((x & 0x80) ? 0x1B : 0);
+            y >>= 1;
+        }
+        return ret;
+    }
+
+    AESTables()
+    {
+        for (u32 i = 0; i < 256; i++) {
+            // Multiplicative inverse is x^254, zero maps to zero
+            u8 inv = 1;
+            for (u32 j = 0; j < 254; j++)
+                inv = Mul(inv, i);
+
+            u8 value = inv;
+            for (u32 j = 1; j < 5; j++)
+                value ^= (inv << j) | (inv >> (8 - j));
+            value ^= 0x63;
+
+            sbox[i] = value;
+            invSbox[value] = i;
+        }
+
+        for (u32 i = 0; i < 15; i++) {
+            for (u32 j = 0; j < 256; j++)
+                mul[i][j] = Mul(j, i);
+        }
+    }
+};
+
+static const AESTables& GetTables()
+{
+    static const AESTables s_tables;
+    return s_tables;
+}
+
+static void ExpandKey(const u8* key, u8* roundKeys)
+{
+    static const u8 Rcon[10] = {
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36,
+    };
+    const AESTables& t = GetTables();
+
+    memcpy(roundKeys, key, 16);
+    for (u32 i = 4; i < 44; i++) {
+        u8 word[4];
+        memcpy(word, roundKeys + (i - 1) * 4, 4);
+
+        if (i % 4 == 0) {
+            const u8 first = word[0];
+            word[0] = t.sbox[word[1]] ^ Rcon[i / 4 - 1];
+            word[1] = t.sbox[word[2]];
+            word[2] = t.sbox[word[3]];
+            word[3] = t.sbox[first];
+        }
+
+        for (u32 j = 0; j < 4; j++)
+            roundKeys[i * 4 + j] = roundKeys[(i - 4) * 4 + j] ^ word[j];
+    }
+}
+
+static void AddRoundKey(u8* state, const u8* roundKey)
+{
+    for (u32 i = 0; i < 16; i++)
+        state[i] ^= roundKey[i];
+}
+
+static void EncryptBlock(const u8* roundKeys, u8* block)
+{
+    const AESTables& t = GetTables();
+    u8 state[16];
+
+    memcpy(state, block, 16);
+    AddRoundKey(state, roundKeys);
+
+    for (u32 round = 1; round <= 10; round++) {
+        // SubBytes and ShiftRows
+        u8 shifted[16];
+        for (u32 c = 0; c < 4; c++) {
+            for (u32 r = 0; r < 4; r++)
+                shifted[c * 4 + r] = t.sbox[state[((c + r) % 4) * 4 + r]];
+        }
+
+        if (round == 10) {
+            memcpy(state, shifted, 16);
+        } else {
+            for (u32 c = 0; c < 4; c++) {
+                const u8* a = shifted + c * 4;
+                state[c * 4 + 0] =
+                    t.mul[2][a[0]] ^ t.mul[3][a[1]] ^ a[2] ^ a[3];
+                state[c * 4 + 1] =
+                    a[0] ^ t.mul[2][a[1]] ^ t.mul[3][a[2]] ^ a[3];
+                state[c * 4 + 2] =
+                    a[0] ^ a[1] ^ t.mul[2][a[2]] ^ t.mul[3][a[3]];
+                state[c * 4 + 3] =
+                    t.mul[3][a[0]] ^ a[1] ^ a[2] ^ t.mul[2][a[3]];
+            }
+        }
+
+        AddRoundKey(state, roundKeys + round * 16);
+    }
+
+    memcpy(block, state, 16);
+}
+
+static void DecryptBlock(const u8* roundKeys, u8* block)
+{
+    const AESTables& t = GetTables();
+    u8 state[16];
+
+    memcpy(state, block, 16);
+    AddRoundKey(state, roundKeys + 10 * 16);
+
+    for (s32 round = 9; round >= 0; round--) {
+        // InvShiftRows and InvSubBytes
+        u8 shifted[16];
+        for (u32 c = 0; c < 4; c++) {
+            for (u32 r = 0; r < 4; r++)
+                shifted[((c + r) % 4) * 4 + r] = t.invSbox[state[c * 4 + r]];
+        }
+
+        AddRoundKey(shifted, roundKeys + round * 16);
+
+        if (round == 0) {
+            memcpy(state, shifted, 16);
+            break;
+        }
+
+        for (u32 c = 0; c < 4; c++) {
+            const u8* a = shifted + c * 4;
+            state[c * 4 + 0] = t.mul[14][a[0]] ^ t.mul[11][a[1]] ^
+                               t.mul[13][a[2]] ^ t.mul[9][a[3]];
+            state[c * 4 + 1] = t.mul[9][a[0]] ^ t.mul[14][a[1]] ^
+                               t.mul[11][a[2]] ^ t.mul[13][a[3]];
+            state[c * 4 + 2] = t.mul[13][a[0]] ^ t.mul[9][a[1]] ^
+                               t.mul[14][a[2]] ^ t.mul[11][a[3]];
+            state[c * 4 + 3] = t.mul[11][a[0]] ^ t.mul[13][a[1]] ^
+                               t.mul[9][a[2]] ^ t.mul[14][a[3]];
+        }
+    }
+
+    memcpy(block, state, 16);
+}
+
+/*
+ * AES-128 CBC, with the same vectors as /dev/aes: input and key in, output
+ * and IV out. The IV is updated for the next call like the real engine.
+ */
+s32 AESIoctlv(u32 cmd, u32 inCount, u32 outCount, IOVector* vec)
+{
+    if (inCount != 2 || outCount != 2 || vec[1].len != 16 ||
+        vec[3].len != 16 || vec[0].len != vec[2].len || vec[0].len % 16 != 0)
+        return IOS_EINVAL;
+
+    if (cmd != u32(AESIoctl::Encrypt) && cmd != u32(AESIoctl::Decrypt))
+        return IOS_EINVAL;
+
+    u8 roundKeys[11 * 16];
+    ExpandKey(reinterpret_cast<const u8*>(vec[1].data), roundKeys);
+
+    const u8* input = reinterpret_cast<const u8*>(vec[0].data);
+    u8* output = reinterpret_cast<u8*>(vec[2].data);
+    u8* iv = reinterpret_cast<u8*>(vec[3].data);
+
+    for (u32 pos = 0; pos < vec[0].len; pos += 16) {
+        u8 block[16];
+        memcpy(block, input + pos, 16);
+
+        if (cmd == u32(AESIoctl::Encrypt)) {
+            for (u32 i = 0; i < 16; i++)
+                block[i] ^= iv[i];
+            EncryptBlock(roundKeys, block);
+            memcpy(iv, block, 16);
+        } else {
+            u8 next[16];
+            memcpy(next, block, 16);
+            DecryptBlock(roundKeys, block);
+            for (u32 i = 0; i < 16; i++)
+                block[i] ^= iv[i];
+            memcpy(iv, next, 16);
+        }
+
+        memcpy(output + pos, block, 16);
+    }
+
+    return IOS_SUCCESS;
+}
+
+static u32 Rotl(u32 value, u32 count)
+{
+    return (value << count) | (value >> (32 - count));
+}
+
+static void SHATransform(u32* state, const u8* block)
+{
+    u32 w[80];
+    for (u32 i = 0; i < 16; i++) {
+        w[i] = (u32(block[i * 4]) << 24) | (u32(block[i * 4 + 1]) << 16) |
+               (u32(block[i * 4 + 2]) << 8) | block[i * 4 + 3];
+    }
+    for (u32 i = 16; i < 80; i++)
+        w[i] = Rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    u32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (u32 i = 0; i < 80; i++) {
+        u32 f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        const u32 temp = Rotl(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = Rotl(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+static void SHAAddLength(SHAContext* ctx, u32 len)
+{
+    const u64 bits =
+        ((u64(ctx->count[0]) << 32) | ctx->count[1]) + u64(len) * 8;
+    ctx->count[0] = bits >> 32;
+    ctx->count[1] = bits;
+}
+
+/*
+ * SHA-1 with the same vectors as /dev/sha: data in, context and hash out.
+ * Like the engine, only the final call may pass a partial block.
+ */
+s32 SHAIoctlv(u32 cmd, u32 inCount, u32 outCount, IOVector* vec)
+{
+    if (inCount != 1 || outCount != 2 || vec[1].len < sizeof(SHAContext))
+        return IOS_EINVAL;
+
+    SHAContext* ctx = reinterpret_cast<SHAContext*>(vec[1].data);
+    const u8* data = reinterpret_cast<const u8*>(vec[0].data);
+    u32 len = vec[0].len;
+
+    switch (static_cast<SHAIoctl>(cmd)) {
+    case SHAIoctl::Init:
+        ctx->state[0] = 0x67452301;
+        ctx->state[1] = 0xEFCDAB89;
+        ctx->state[2] = 0x98BADCFE;
+        ctx->state[3] = 0x10325476;
+        ctx->state[4] = 0xC3D2E1F0;
+        ctx->count[0] = 0;
+        ctx->count[1] = 0;
+        return IOS_SUCCESS;
+
+    case SHAIoctl::Update:
+        if (len % 64 != 0)
+            return IOS_EINVAL;
+
+        SHAAddLength(ctx, len);
+        for (u32 pos = 0; pos < len; pos += 64)
+            SHATransform(ctx->state, data + pos);
+        return IOS_SUCCESS;
+
+    case SHAIoctl::Final: {
+        if (vec[2].len < 0x14)
+            return IOS_EINVAL;
+
+        SHAAddLength(ctx, len);
+        for (; len >= 64; len -= 64, data += 64)
+            SHATransform(ctx->state, data);
+
+        u8 block[128] = {};
+        memcpy(block, data, len);
+        block[len] = 0x80;
+
+        const u32 padLen = len < 56 ? 64 : 128;
+        for (u32 i = 0; i < 8; i++)
+            block[padLen - 1 - i] = ctx->count[1 - i / 4] >> ((i % 4) * 8);
+
+        SHATransform(ctx->state, block);
+        if (padLen == 128)
+            SHATransform(ctx->state, block + 64);
+
+        u8* hash = reinterpret_cast<u8*>(vec[2].data);
+        for (u32 i = 0; i < 0x14; i++)
+            hash[i] = ctx->state[i / 4] >> ((3 - i % 4) * 8);
+        return IOS_SUCCESS;
+    }
+
+    default:
+        return IOS_EINVAL;
+    }
+}
+
+} // namespace Crypto
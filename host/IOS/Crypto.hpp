@@ -0,0 +1,24 @@
+// Crypto.hpp - Software /dev/aes and /dev/sha for the host build
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <IOS/Syscalls.h>
+#include <System/Types.h>
+
+namespace Crypto
+{
+
+/*
+ * Same layout as the SHA::Context the callers pass in.
+ */
+struct SHAContext {
+    u32 state[5];
+    u32 count[2];
+};
+
+s32 AESIoctlv(u32 cmd, u32 inCount, u32 outCount, IOVector* vec);
+s32 SHAIoctlv(u32 cmd, u32 inCount, u32 outCount, IOVector* vec);
+
+} // namespace Crypto
@@ -0,0 +1,65 @@
+// IPCLog.cpp - IOS to PowerPC logging for the host build
+//
+// SPDX-License-Identifier: MIT
+
+#include <IOS/IPCLog.hpp>
+#include <cstdio>
+
+/*
+ * There is no PPC to talk to, so logs go to stdout and notifications are
+ * queued for the host driver instead.
+ */
+
+IPCLog* IPCLog::sInstance;
+
+IPCLog::IPCLog()
+    : m_ipcQueue(8), m_responseQueue(1), m_startRequestQueue(1),
+      m_ring(nullptr), m_ringWaitReq(nullptr)
+{
+}
+
+void IPCLog::Print(const char* buffer)
+{
+    printf("%s\n", buffer);
+}
+
+void IPCLog::Notify(u32 id)
+{
+    printf("[IPCLog] Notify %u\n", id);
+
+    // Don't hold up the storage code if nobody is waiting
+    IOS_SendMessage(m_ipcQueue.id(), id, 1);
+}
+
+void IPCLog::SetLaunchState(LaunchError state)
+{
+    printf("[IPCLog] Launch state %d\n", static_cast<s32>(state));
+}
+
+void IPCLog::WaitForStartRequest(void** dolAddr, u32* dolSize)
+{
+    *dolAddr = nullptr;
+    *dolSize = 0;
+}
+
+/*
+ * Wait up to usec for the next Notify. Returns the ID, or -1 on timeout.
+ */
+s32 IPCLog::WaitForNotify(u32 usec)
+{
+    // Timeouts are tagged so a late one from an earlier call is ignored
+    static u32 s_timeoutSeq = 0;
+    const u32 token = 0x80000000 | (++s_timeoutSeq & 0x7FFFFFFF);
+
+    const s32 timer = IOS_CreateTimer(usec, 0, m_ipcQueue.id(), token);
+    ASSERT(timer >= 0);
+
+    IOSMessage id;
+    do {
+        const s32 ret = IOS_ReceiveMessage(m_ipcQueue.id(), &id, 0);
+        ASSERT(ret == IOSError::OK);
+    } while ((id & 0x80000000) && id != token);
+
+    IOS_DestroyTimer(timer);
+    return id == token ? -1 : s32(id);
+}
@@ -0,0 +1,362 @@
+// MMIO.cpp - Hollywood register model for the host build
+//
+// SPDX-License-Identifier: MIT
+
+#include "MMIO.hpp"
+#include "Crypto.hpp"
+#include <System/Hollywood.hpp>
+#include <cstring>
+#include <pthread.h>
+#include <time.h>
+
+namespace MMIO
+{
+
+// Reads of CTRL that see the engine busy with a command of IOSC's
+static constexpr u32 ContentionReads = 3;
+
+// Engine state IOSC's commands finish with
+static constexpr u32 IOSCHash = 0xA5A5A5A5;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool s_enginesEnabled = false;
+static bool s_contention = false;
+static bool s_irqsMasked = false;
+static bool s_disturbed = false;
+// IOSC starts a command every other time interrupts are restored
+static u32 s_restoreCount = 0;
+
+enum class IOSCState {
+    Idle,
+    // Reads as busy
+    Running,
+    // Finished, the interrupt hasn't been handled
+    Pending,
+    // Interrupt handled, the result hasn't been read back
+    Handled,
+};
+
+struct IOSCCommand {
+    IOSCState state;
+    u32 busyReads;
+};
+
+struct AESState {
+    u32 ctrl;
+    u32 src;
+    u32 dest;
+    u8 keyFifo[16];
+    u8 ivFifo[16];
+    u32 keyPos;
+    u32 ivPos;
+    // Key and IV the last command finished with, for AESCtrlBit::IV
+    u8 key[16];
+    u8 iv[16];
+    IOSCCommand iosc;
+};
+
+static AESState s_aes;
+
+struct SHAState {
+    u32 ctrl;
+    u32 src;
+    u32 h[5];
+    IOSCCommand iosc;
+};
+
+static SHAState s_sha;
+
+void SetEnginesEnabled(bool enabled)
+{
+    s_enginesEnabled = enabled;
+}
+
+void SetContention(bool contention)
+{
+    pthread_mutex_lock(&s_lock);
+    s_contention = contention;
+    s_disturbed = false;
+    s_restoreCount = 0;
+    s_aes.iosc = {};
+    s_sha.iosc = {};
+    pthread_mutex_unlock(&s_lock);
+}
+
+bool IOSCDisturbed()
+{
+    return s_disturbed;
+}
+
+/*
+ * Returns true while IOSC's command reads as busy.
+ */
+static bool IOSCBusy(IOSCCommand* iosc)
+{
+    if (iosc->state != IOSCState::Running)
+        return false;
+
+    if (--iosc->busyReads == 0)
+        iosc->state = IOSCState::Pending;
+    return true;
+}
+
+static void IOSCStart(IOSCCommand* iosc)
+{
+    iosc->state = IOSCState::Running;
+    iosc->busyReads = ContentionReads;
+}
+
+static void AESRestore(bool start)
+{
+    switch (s_aes.iosc.state) {
+    case IOSCState::Idle:
+        if (start) {
+            memset(s_aes.key, IOSCHash & 0xFF, 16);
+            memset(s_aes.iv, IOSCHash & 0xFF, 16);
+            s_aes.keyPos = 0;
+            s_aes.ivPos = 0;
+            IOSCStart(&s_aes.iosc);
+        }
+        break;
+    case IOSCState::Running:
+        break;
+    case IOSCState::Pending:
+        s_aes.iosc.state = IOSCState::Handled;
+        break;
+    case IOSCState::Handled:
+        s_aes.iosc.state = IOSCState::Idle;
+        break;
+    }
+}
+
+static void SHARestore(bool start)
+{
+    switch (s_sha.iosc.state) {
+    case IOSCState::Idle:
+        if (start) {
+            for (u32 i = 0; i < 5; i++)
+                s_sha.h[i] = IOSCHash;
+            s_sha.src = IOSCHash & ~0x3F;
+            IOSCStart(&s_sha.iosc);
+        }
+        break;
+    case IOSCState::Running:
+        break;
+    case IOSCState::Pending:
+        s_sha.iosc.state = IOSCState::Handled;
+        break;
+    case IOSCState::Handled:
+        for (u32 i = 0; i < 5; i++) {
+            if (s_sha.h[i] != IOSCHash)
+                s_disturbed = true;
+        }
+        s_sha.iosc.state = IOSCState::Idle;
+        break;
+    }
+}
+
+void SetIRQsMasked(bool masked)
+{
+    pthread_mutex_lock(&s_lock);
+    if (s_irqsMasked && !masked && s_contention) {
+        const bool start = s_restoreCount++ % 2 == 0;
+        AESRestore(start);
+        SHARestore(start);
+    }
+    s_irqsMasked = masked;
+    pthread_mutex_unlock(&s_lock);
+}
+
+static void FIFOWrite(u8* fifo, u32* pos, u32 value)
+{
+    memcpy(fifo + *pos, &value, 4);
+    *pos = (*pos + 4) % 16;
+}
+
+static u8* DMAAddress(u32 address)
+{
+    return reinterpret_cast<u8*>(uintptr_t(address));
+}
+
+/*
+ * Run an AES command synchronously when it's started, using the software
+ * /dev/aes.
+ */
+static void AESExecute(u32 ctrl)
+{
+    const u32 size = ((ctrl & 0xFFF) + 1) * 16;
+
+    if (!(ctrl & u32(AESCtrlBit::IV)))
+        memcpy(s_aes.iv, s_aes.ivFifo, 16);
+    memcpy(s_aes.key, s_aes.keyFifo, 16);
+
+    if (ctrl & u32(AESCtrlBit::ENA)) {
+        IOVector vec[4] = {
+            {DMAAddress(s_aes.src), size},
+            {s_aes.key, 16},
+            {DMAAddress(s_aes.dest), size},
+            {s_aes.iv, 16},
+        };
+        const u32 cmd = (ctrl & u32(AESCtrlBit::DEC)) ? 3 : 2;
+        if (Crypto::AESIoctlv(cmd, 2, 2, vec) != IOS_SUCCESS)
+            ctrl |= u32(AESCtrlBit::ERR);
+    } else {
+        memmove(DMAAddress(s_aes.dest), DMAAddress(s_aes.src), size);
+    }
+
+    s_aes.src += size;
+    s_aes.dest += size;
+    s_aes.ctrl = ctrl & ~u32(AESCtrlBit::EXEC);
+}
+
+static u32 AESRead(u32 reg)
+{
+    switch (static_cast<AESReg>(reg)) {
+    case AESReg::CTRL:
+        if (IOSCBusy(&s_aes.iosc))
+            return s_aes.ctrl | u32(AESCtrlBit::EXEC);
+        return s_aes.ctrl;
+    case AESReg::SRC:
+        return s_aes.src;
+    case AESReg::DEST:
+        return s_aes.dest;
+    default:
+        return 0;
+    }
+}
+
+static void AESWrite(u32 reg, u32 value)
+{
+    switch (static_cast<AESReg>(reg)) {
+    case AESReg::CTRL:
+        if (value & u32(AESCtrlBit::EXEC))
+            AESExecute(value);
+        else
+            s_aes.ctrl = value;
+        break;
+    case AESReg::SRC:
+        s_aes.src = value;
+        break;
+    case AESReg::DEST:
+        s_aes.dest = value;
+        break;
+    case AESReg::KEY:
+        FIFOWrite(s_aes.keyFifo, &s_aes.keyPos, value);
+        break;
+    case AESReg::IV:
+        FIFOWrite(s_aes.ivFifo, &s_aes.ivPos, value);
+        break;
+    }
+}
+
+/*
+ * Run a SHA-1 command synchronously when it's started, using the software
+ * /dev/sha.
+ */
+static void SHAExecute(u32 ctrl)
+{
+    const u32 size = ((ctrl & 0x3FF) + 1) * 64;
+
+    Crypto::SHAContext ctx = {};
+    memcpy(ctx.state, s_sha.h, sizeof(ctx.state));
+
+    IOVector vec[3] = {
+        {DMAAddress(s_sha.src), size},
+        {&ctx, sizeof(ctx)},
+        {nullptr, 0},
+    };
+    if (Crypto::SHAIoctlv(1, 1, 2, vec) != IOS_SUCCESS)
+        ctrl |= u32(SHACtrlBit::ERR);
+
+    memcpy(s_sha.h, ctx.state, sizeof(s_sha.h));
+    s_sha.src += size;
+    s_sha.ctrl = ctrl & ~u32(SHACtrlBit::EXEC);
+}
+
+static u32 SHARead(u32 reg)
+{
+    switch (static_cast<SHAReg>(reg)) {
+    case SHAReg::CTRL:
+        if (IOSCBusy(&s_sha.iosc))
+            return s_sha.ctrl | u32(SHACtrlBit::EXEC);
+        return s_sha.ctrl;
+    case SHAReg::SRC:
+        return s_sha.src;
+    default:
+        return s_sha.h[(reg - u32(SHAReg::H0)) / 4];
+    }
+}
+
+static void SHAWrite(u32 reg, u32 value)
+{
+    switch (static_cast<SHAReg>(reg)) {
+    case SHAReg::CTRL:
+        if (value & u32(SHACtrlBit::EXEC))
+            SHAExecute(value);
+        else
+            s_sha.ctrl = value;
+        break;
+    case SHAReg::SRC:
+        s_sha.src = value;
+        break;
+    default:
+        s_sha.h[(reg - u32(SHAReg::H0)) / 4] = value;
+        break;
+    }
+}
+
+static u32 ACRRead(u32 reg)
+{
+    switch (static_cast<ACRReg>(reg)) {
+    case ACRReg::TIMER: {
+        // 243 MHz / 128
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (u64(ts.tv_sec) * 1000000000 + ts.tv_nsec) * 243 / 128000;
+    }
+    case ACRReg::BUSPROT:
+        return s_enginesEnabled ? u32(ACRBUSPROTBit::IOPAESEN) |
+                                      u32(ACRBUSPROTBit::IOPSHAEN)
+                                : 0;
+    case ACRReg::ARM_IRQFLAG:
+        return (s_aes.iosc.state == IOSCState::Pending ? u32(ACRIRQBit::AES)
+                                                       : 0) |
+               (s_sha.iosc.state == IOSCState::Pending ? u32(ACRIRQBit::SHA)
+                                                       : 0);
+    default:
+        return 0;
+    }
+}
+
+} // namespace MMIO
+
+using namespace MMIO;
+
+u32 HostMMIORead32(uintptr_t address)
+{
+    pthread_mutex_lock(&s_lock);
+    u32 value = 0;
+    if (address - AES_BASE < 0x20)
+        value = AESRead(address - AES_BASE);
+    else if (address - SHA_BASE < 0x1C)
+        value = SHARead(address - SHA_BASE);
+    else if (address - HW_BASE_TRUSTED < 0x400)
+        value = ACRRead(address - HW_BASE_TRUSTED);
+    pthread_mutex_unlock(&s_lock);
+    return value;
+}
+
+void HostMMIOWrite32(uintptr_t address, u32 value)
+{
+    pthread_mutex_lock(&s_lock);
+    // IOSC may have been between any two writes
+    if (s_contention && !s_irqsMasked &&
+        (address - AES_BASE < 0x20 || address - SHA_BASE < 0x1C))
+        s_disturbed = true;
+
+    if (address - AES_BASE < 0x20)
+        AESWrite(address - AES_BASE, value);
+    else if (address - SHA_BASE < 0x1C)
+        SHAWrite(address - SHA_BASE, value);
+    pthread_mutex_unlock(&s_lock);
+}
@@ -0,0 +1,43 @@
+// MMIO.hpp - Hollywood register model for the host build
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <System/Types.h>
+
+/*
+ * read32 and write32 on Hollywood register addresses end up here in the host
+ * build, see HostIsMMIO in Util.h. The ACR timer and bus protection registers
+ * and the AES and SHA-1 engines are modelled, everything else reads as zero.
+ */
+namespace MMIO
+{
+
+/*
+ * Report the engines as usable by the IOP. Off by default, as the engine DMA
+ * addresses are 32-bit and only buffers in .bss are known to fit on a 64-bit
+ * host.
+ */
+void SetEnginesEnabled(bool enabled);
+
+/*
+ * Act like IOSC uses the engines whenever interrupts are enabled. Every other
+ * time they're restored it starts a command of its own, which scrambles the
+ * engine state and reads as busy for a while, then as a pending interrupt. It
+ * reads back its result two restores later, after the interrupt was handled.
+ */
+void SetContention(bool contention);
+
+/*
+ * Whether an engine register was written with interrupts enabled, or IOSC
+ * read back a result that was overwritten, since SetContention.
+ */
+bool IOSCDisturbed();
+
+/*
+ * Called by IRQDisable and IRQRestore.
+ */
+void SetIRQsMasked(bool masked);
+
+} // namespace MMIO
@@ -0,0 +1,957 @@
+// Syscalls.cpp - IOS system calls for the host build
+//
+// SPDX-License-Identifier: MIT
+
+#include "Crypto.hpp"
+#include <IOS/Syscalls.h>
+#include <System/Types.h>
+#include <System/Util.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+/*
+ * Threads, message queues and timers are backed by POSIX threads, and IPC
+ * requests are passed to resource managers registered in this process. The
+ * /dev/aes and /dev/sha devices are served directly in software. Everything
+ * is protected by a single lock, which is plenty for a test harness.
+ */
+
+// Not in Syscalls.h as nothing on IOS checks for it
+#define IOS_EQUEUEEMPTY -7
+
+static constexpr u32 MaxThreads = 100;
+static constexpr u32 MaxQueues = 256;
+static constexpr u32 MaxTimers = 32;
+static constexpr u32 MaxHeaps = 16;
+static constexpr u32 MaxManagers = 16;
+static constexpr u32 MaxFiles = 64;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static u64 GetMonotonicUsec()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return u64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* <----------
+ * IOS Thread
+ * ----------> */
+struct HostThread {
+    bool used;
+    bool started;
+    bool detached;
+    pthread_t handle;
+    IOSThreadProc proc;
+    void* arg;
+    u32 priority;
+};
+
+static HostThread s_threads[MaxThreads];
+static thread_local s32 t_threadId = -1;
+
+static s32 AllocThread()
+{
+    for (u32 i = 0; i < MaxThreads; i++) {
+        if (!s_threads[i].used) {
+            s_threads[i] = {};
+            s_threads[i].used = true;
+            return i;
+        }
+    }
+
+    return IOS_EMAX;
+}
+
+static void* ThreadProc(void* arg)
+{
+    const s32 id = s32(reinterpret_cast<intptr_t>(arg));
+    t_threadId = id;
+
+    const s32 ret = s_threads[id].proc(s_threads[id].arg);
+    return reinterpret_cast<void*>(intptr_t(ret));
+}
+
+s32 IOS_CreateThread(IOSThreadProc proc, void* arg, u32* stack_top,
+                     u32 stacksize, s32 priority, bool detached)
+{
+    // The IOS stack is too small for host libc, so use a default one
+    pthread_mutex_lock(&s_lock);
+    const s32 id = AllocThread();
+    if (id >= 0) {
+        s_threads[id].proc = proc;
+        s_threads[id].arg = arg;
+        s_threads[id].priority = priority;
+        s_threads[id].detached = detached;
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    return id;
+}
+
+s32 IOS_StartThread(s32 threadid)
+{
+    if (threadid < 0 || u32(threadid) >= MaxThreads)
+        return IOS_EINVAL;
+
+    HostThread* thread = &s_threads[threadid];
+    if (!thread->used || thread->started)
+        return IOS_EINVAL;
+
+    thread->started = true;
+    if (pthread_create(&thread->handle, nullptr, ThreadProc,
+                       reinterpret_cast<void*>(intptr_t(threadid))) != 0) {
+        thread->started = false;
+        return IOS_ENOMEM;
+    }
+
+    if (thread->detached)
+        pthread_detach(thread->handle);
+
+    return IOS_SUCCESS;
+}
+
+s32 IOS_JoinThread(s32 threadid, void** value)
+{
+    if (threadid < 0 || u32(threadid) >= MaxThreads)
+        return IOS_EINVAL;
+
+    HostThread* thread = &s_threads[threadid];
+    if (!thread->started || thread->detached)
+        return IOS_EINVAL;
+
+    pthread_join(thread->handle, value);
+
+    pthread_mutex_lock(&s_lock);
+    thread->used = false;
+    pthread_mutex_unlock(&s_lock);
+    return IOS_SUCCESS;
+}
+
+s32 IOS_CancelThread(s32 threadid, void* value)
+{
+    // Only a thread exiting itself is supported
+    if (threadid != 0 && threadid != IOS_GetThreadId())
+        return IOS_EINVAL;
+
+    pthread_exit(value);
+}
+
+s32 IOS_GetThreadId(void)
+{
+    // Threads not created through IOS, like main, get an ID on first use
+    if (t_threadId < 0) {
+        pthread_mutex_lock(&s_lock);
+        t_threadId = AllocThread();
+        if (t_threadId >= 0) {
+            s_threads[t_threadId].started = true;
+            s_threads[t_threadId].detached = true;
+            s_threads[t_threadId].handle = pthread_self();
+        }
+        pthread_mutex_unlock(&s_lock);
+    }
+
+    return t_threadId;
+}
+
+s32 IOS_GetProcessId(void)
+{
+    return 0;
+}
+
+s32 IOS_SuspendThread(s32 threadid)
+{
+    return IOS_EINVAL;
+}
+
+void IOS_YieldThread(void)
+{
+    sched_yield();
+}
+
+u32 IOS_GetThreadPriority(s32 threadid)
+{
+    if (threadid == 0)
+        threadid = IOS_GetThreadId();
+    if (threadid < 0 || u32(threadid) >= MaxThreads)
+        return 0;
+
+    return s_threads[threadid].priority;
+}
+
+s32 IOS_SetThreadPriority(s32 threadid, u32 priority)
+{
+    // Priorities are recorded, but the host scheduler ignores them
+    if (threadid == 0)
+        threadid = IOS_GetThreadId();
+    if (threadid < 0 || u32(threadid) >= MaxThreads)
+        return IOS_EINVAL;
+
+    s_threads[threadid].priority = priority;
+    return IOS_SUCCESS;
+}
+
+/* <----------
+ * IOS Message
+ * ----------> */
+struct HostQueue {
+    bool used;
+    IOSMessage* buf;
+    u32 count;
+    u32 head;
+    u32 size;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+};
+
+static HostQueue s_queues[MaxQueues];
+
+static HostQueue* GetQueue(s32 queue_id)
+{
+    if (queue_id < 0 || u32(queue_id) >= MaxQueues ||
+        !s_queues[queue_id].used)
+        return nullptr;
+
+    return &s_queues[queue_id];
+}
+
+s32 IOS_CreateMessageQueue(IOSMessage* buf, u32 msg_count)
+{
+    if (buf == nullptr || msg_count == 0)
+        return IOS_EINVAL;
+
+    pthread_mutex_lock(&s_lock);
+    s32 ret = IOS_EMAX;
+    for (u32 i = 0; i < MaxQueues; i++) {
+        if (s_queues[i].used)
+            continue;
+
+        HostQueue* queue = &s_queues[i];
+        queue->used = true;
+        queue->buf = buf;
+        queue->count = msg_count;
+        queue->head = 0;
+        queue->size = 0;
+        pthread_cond_init(&queue->notEmpty, nullptr);
+        pthread_cond_init(&queue->notFull, nullptr);
+        ret = i;
+        break;
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    return ret;
+}
+
+s32 IOS_DestroyMessageQueue(s32 queue_id)
+{
+    pthread_mutex_lock(&s_lock);
+    HostQueue* queue = GetQueue(queue_id);
+    if (queue == nullptr) {
+        pthread_mutex_unlock(&s_lock);
+        return IOS_EINVAL;
+    }
+
+    pthread_cond_destroy(&queue->notEmpty);
+    pthread_cond_destroy(&queue->notFull);
+    queue->used = false;
+    pthread_mutex_unlock(&s_lock);
+
+    return IOS_SUCCESS;
+}
+
+/*
+ * Put a message in the queue. Lock must be held.
+ */
+static s32 SendLocked(s32 queue_id, IOSMessage message, u32 flags,
+                      bool jam)
+{
+    HostQueue* queue = GetQueue(queue_id);
+    if (queue == nullptr)
+        return IOS_EINVAL;
+
+    while (queue->size == queue->count) {
+        if (flags != 0)
+            return IOS_EQUEUEFULL;
+        pthread_cond_wait(&queue->notFull, &s_lock);
+    }
+
+    if (jam) {
+        queue->head = (queue->head + queue->count - 1) % queue->count;
+        queue->buf[queue->head] = message;
+    } else {
+        queue->buf[(queue->head + queue->size) % queue->count] = message;
+    }
+
+    queue->size++;
+    pthread_cond_signal(&queue->notEmpty);
+    return IOS_SUCCESS;
+}
+
+s32 IOS_SendMessage(s32 queue_id, IOSMessage message, u32 flags)
+{
+    pthread_mutex_lock(&s_lock);
+    const s32 ret = SendLocked(queue_id, message, flags, false);
+    pthread_mutex_unlock(&s_lock);
+
+    return ret;
+}
+
+s32 IOS_JamMessage(s32 queue_id, IOSMessage message, u32 flags)
+{
+    pthread_mutex_lock(&s_lock);
+    const s32 ret = SendLocked(queue_id, message, flags, true);
+    pthread_mutex_unlock(&s_lock);
+
+    return ret;
+}
+
+s32 IOS_ReceiveMessage(s32 queue_id, IOSMessage* message, u32 flags)
+{
+    pthread_mutex_lock(&s_lock);
+    HostQueue* queue = GetQueue(queue_id);
+    if (queue == nullptr) {
+        pthread_mutex_unlock(&s_lock);
+        return IOS_EINVAL;
+    }
+
+    while (queue->size == 0) {
+        if (flags != 0) {
+            pthread_mutex_unlock(&s_lock);
+            return IOS_EQUEUEEMPTY;
+        }
+        pthread_cond_wait(&queue->notEmpty, &s_lock);
+    }
+
+    *message = queue->buf[queue->head];
+    queue->head = (queue->head + 1) % queue->count;
+    queue->size--;
+    pthread_cond_signal(&queue->notFull);
+    pthread_mutex_unlock(&s_lock);
+
+    return IOS_SUCCESS;
+}
+
+/* <----------
+ * IOS Timer
+ * ----------> */
+struct HostTimer {
+    bool used;
+    bool armed;
+    u64 deadline;
+    u32 period;
+    s32 queue;
+    IOSMessage msg;
+};
+
+static HostTimer s_timers[MaxTimers];
+static pthread_cond_t s_timerCond;
+static bool s_timerThreadStarted = false;
+
+/*
+ * Single service thread for every timer. Like the hardware, a message that
+ * doesn't fit in the queue is dropped rather than blocking other timers.
+ */
+static void* TimerThreadProc(void* arg)
+{
+    pthread_mutex_lock(&s_lock);
+    while (true) {
+        const u64 now = GetMonotonicUsec();
+        u64 next = 0;
+
+        for (u32 i = 0; i < MaxTimers; i++) {
+            HostTimer* timer = &s_timers[i];
+            if (!timer->used || !timer->armed)
+                continue;
+
+            if (timer->deadline <= now) {
+                SendLocked(timer->queue, timer->msg, 1, false);
+
+                if (timer->period == 0) {
+                    timer->armed = false;
+                    continue;
+                }
+
+                timer->deadline += timer->period;
+                if (timer->deadline <= now)
+                    timer->deadline = now + timer->period;
+            }
+
+            if (next == 0 || timer->deadline < next)
+                next = timer->deadline;
+        }
+
+        if (next == 0) {
+            pthread_cond_wait(&s_timerCond, &s_lock);
+            continue;
+        }
+
+        timespec ts = {
+            .tv_sec = time_t(next / 1000000),
+            .tv_nsec = long(next % 1000000) * 1000,
+        };
+        pthread_cond_timedwait(&s_timerCond, &s_lock, &ts);
+    }
+
+    return nullptr;
+}
+
+/*
+ * Arm a timer and wake the service thread. Lock must be held.
+ */
+static void ArmLocked(HostTimer* timer, s32 usec, s32 repeat_usec)
+{
+    timer->deadline = GetMonotonicUsec() + u32(usec);
+    timer->period = repeat_usec;
+    timer->armed = true;
+
+    if (!s_timerThreadStarted) {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&s_timerCond, &attr);
+        pthread_condattr_destroy(&attr);
+
+        pthread_t thread;
+        pthread_create(&thread, nullptr, TimerThreadProc, nullptr);
+        pthread_detach(thread);
+        s_timerThreadStarted = true;
+    }
+
+    pthread_cond_signal(&s_timerCond);
+}
+
+static HostTimer* GetTimer(s32 timer)
+{
+    if (timer < 0 || u32(timer) >= MaxTimers || !s_timers[timer].used)
+        return nullptr;
+
+    return &s_timers[timer];
+}
+
+s32 IOS_CreateTimer(s32 usec, s32 repeat_usec, s32 queue, IOSMessage msg)
+{
+    pthread_mutex_lock(&s_lock);
+    s32 ret = IOS_EMAX;
+    for (u32 i = 0; i < MaxTimers; i++) {
+        if (s_timers[i].used)
+            continue;
+
+        s_timers[i] = {
+            .used = true,
+            .armed = false,
+            .deadline = 0,
+            .period = 0,
+            .queue = queue,
+            .msg = msg,
+        };
+        ArmLocked(&s_timers[i], usec, repeat_usec);
+        ret = i;
+        break;
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    return ret;
+}
+
+s32 IOS_RestartTimer(s32 timer, s32 usec, s32 repeat_usec)
+{
+    pthread_mutex_lock(&s_lock);
+    HostTimer* entry = GetTimer(timer);
+    if (entry != nullptr)
+        ArmLocked(entry, usec, repeat_usec);
+    pthread_mutex_unlock(&s_lock);
+
+    return entry != nullptr ? IOS_SUCCESS : IOS_EINVAL;
+}
+
+s32 IOS_StopTimer(s32 timer)
+{
+    pthread_mutex_lock(&s_lock);
+    HostTimer* entry = GetTimer(timer);
+    if (entry != nullptr)
+        entry->armed = false;
+    pthread_mutex_unlock(&s_lock);
+
+    return entry != nullptr ? IOS_SUCCESS : IOS_EINVAL;
+}
+
+s32 IOS_DestroyTimer(s32 timer)
+{
+    pthread_mutex_lock(&s_lock);
+    HostTimer* entry = GetTimer(timer);
+    if (entry != nullptr)
+        entry->used = false;
+    pthread_mutex_unlock(&s_lock);
+
+    return entry != nullptr ? IOS_SUCCESS : IOS_EINVAL;
+}
+
+u32 IOS_GetTime()
+{
+    // Same rate as the Hollywood timer
+    return GetMonotonicUsec() * 243 / 128;
+}
+
+/* <----------
+ * IOS Memory
+ * ----------> */
+static bool s_heaps[MaxHeaps];
+
+/*
+ * Heap blocks come from the host allocator so valgrind can track them. The
+ * memory passed to IOS_CreateHeap is left unused.
+ */
+s32 IOS_CreateHeap(void* ptr, s32 length)
+{
+    pthread_mutex_lock(&s_lock);
+    s32 ret = IOS_EMAX;
+    // Heap 0 is the shared IPC heap and always exists
+    for (u32 i = 1; i < MaxHeaps; i++) {
+        if (!s_heaps[i]) {
+            s_heaps[i] = true;
+            ret = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    return ret;
+}
+
+s32 IOS_DestroyHeap(s32 heap)
+{
+    if (heap <= 0 || u32(heap) >= MaxHeaps || !s_heaps[heap])
+        return IOS_EINVAL;
+
+    s_heaps[heap] = false;
+    return IOS_SUCCESS;
+}
+
+void* IOS_Alloc(s32 heap, u32 length)
+{
+    return IOS_AllocAligned(heap, length, 32);
+}
+
+void* IOS_AllocAligned(s32 heap, u32 length, u32 align)
+{
+    if (heap < 0 || u32(heap) >= MaxHeaps || (heap != 0 && !s_heaps[heap]))
+        return nullptr;
+
+    return aligned_alloc(align, round_up(length, align));
+}
+
+s32 IOS_Free(s32 heap, void* ptr)
+{
+    free(ptr);
+    return IOS_SUCCESS;
+}
+
+/* <----------
+ * IPC (Inter-process communication)
+ * ----------> */
+enum class HostFileKind {
+    AES,
+    SHA,
+    Manager,
+};
+
+struct HostFile {
+    bool used;
+    HostFileKind kind;
+    s32 queue;
+    s32 handle;
+};
+
+struct HostManager {
+    char path[64];
+    s32 queue;
+};
+
+/*
+ * A request in flight to a resource manager. The manager only sees req, and
+ * IOS_ResourceReply finds the rest from it.
+ */
+struct HostPending {
+    IOSRequest req;
+    s32 queue;
+    s32 replyQueue;
+    IOSRequest* asyncMsg;
+};
+
+static HostFile s_files[MaxFiles];
+static HostManager s_managers[MaxManagers];
+static u32 s_managerCount = 0;
+
+static s32 AllocFile(HostFileKind kind, s32 queue, s32 handle)
+{
+    pthread_mutex_lock(&s_lock);
+    s32 ret = IOS_EMAX;
+    for (u32 i = 0; i < MaxFiles; i++) {
+        if (!s_files[i].used) {
+            s_files[i] = {
+                .used = true,
+                .kind = kind,
+                .queue = queue,
+                .handle = handle,
+            };
+            ret = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    return ret;
+}
+
+static void FreeFile(s32 fd)
+{
+    pthread_mutex_lock(&s_lock);
+    s_files[fd].used = false;
+    pthread_mutex_unlock(&s_lock);
+}
+
+/*
+ * Send the reply for an asynchronous request to its queue.
+ */
+static void ReplyAsync(IOSRequest* msg, s32 queue, s32 result)
+{
+    msg->cmd = IOS_IPC_REPLY;
+    msg->result = result;
+    IOS_SendMessage(queue, reinterpret_cast<IOSMessage>(msg), 0);
+}
+
+static s32 BuiltinRequest(HostFileKind kind, const IOSRequest* req)
+{
+    switch (req->cmd) {
+    case IOS_CLOSE:
+        return IOS_SUCCESS;
+
+    case IOS_IOCTLV:
+        if (kind == HostFileKind::AES) {
+            return Crypto::AESIoctlv(req->ioctlv.cmd, req->ioctlv.in_count,
+                                     req->ioctlv.io_count, req->ioctlv.vec);
+        }
+
+        return Crypto::SHAIoctlv(req->ioctlv.cmd, req->ioctlv.in_count,
+                                 req->ioctlv.io_count, req->ioctlv.vec);
+
+    default:
+        return IOS_EINVAL;
+    }
+}
+
+/*
+ * Pass a request to a resource manager. Without msg it waits for the reply,
+ * otherwise the reply is sent to queue_id.
+ */
+static s32 ManagerRequest(s32 queue, const IOSRequest* req, s32 queue_id,
+                          IOSRequest* msg)
+{
+    if (msg != nullptr) {
+        HostPending* pending = new HostPending;
+        pending->req = *req;
+        pending->queue = queue;
+        pending->replyQueue = queue_id;
+        pending->asyncMsg = msg;
+
+        const s32 ret = IOS_SendMessage(
+            queue, reinterpret_cast<IOSMessage>(&pending->req), 0);
+        if (ret != IOS_SUCCESS)
+            delete pending;
+        return ret;
+    }
+
+    IOSMessage replyData;
+    HostPending pending = {
+        .req = *req,
+        .queue = queue,
+        .replyQueue = IOS_CreateMessageQueue(&replyData, 1),
+        .asyncMsg = nullptr,
+    };
+    if (pending.replyQueue < 0)
+        return pending.replyQueue;
+
+    s32 ret = IOS_SendMessage(queue, reinterpret_cast<IOSMessage>(&pending.req), 0);
+    if (ret == IOS_SUCCESS) {
+        IOS_ReceiveMessage(pending.replyQueue, &replyData, 0);
+        ret = pending.req.result;
+    }
+
+    IOS_DestroyMessageQueue(pending.replyQueue);
+    return ret;
+}
+
+static s32 Submit(s32 fd, IOSRequest* req, s32 queue_id, IOSRequest* msg)
+{
+    if (fd < 0 || u32(fd) >= MaxFiles || !s_files[fd].used)
+        return IOS_EINVAL;
+
+    HostFile* file = &s_files[fd];
+    if (file->kind != HostFileKind::Manager) {
+        const s32 ret = BuiltinRequest(file->kind, req);
+        if (req->cmd == IOS_CLOSE && ret >= 0)
+            FreeFile(fd);
+
+        if (msg == nullptr)
+            return ret;
+
+        ReplyAsync(msg, queue_id, ret);
+        return IOS_SUCCESS;
+    }
+
+    req->fd = file->handle;
+    const s32 ret = ManagerRequest(file->queue, req, queue_id, msg);
+    if (msg == nullptr && req->cmd == IOS_CLOSE && ret >= 0)
+        FreeFile(fd);
+
+    return ret;
+}
+
+s32 IOS_RegisterResourceManager(const char* device, s32 queue_id)
+{
+    if (strlen(device) >= sizeof(HostManager::path))
+        return IOS_EINVAL;
+
+    pthread_mutex_lock(&s_lock);
+    s32 ret = IOS_EMAX;
+    if (s_managerCount < MaxManagers) {
+        HostManager* manager = &s_managers[s_managerCount++];
+        strcpy(manager->path, device);
+        manager->queue = queue_id;
+        ret = IOS_SUCCESS;
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    return ret;
+}
+
+s32 IOS_ResourceReply(const IOSRequest* request, s32 reply)
+{
+    HostPending* pending =
+        reinterpret_cast<HostPending*>(const_cast<IOSRequest*>(request));
+
+    // The manager's handle becomes a new file descriptor for the caller
+    if (pending->req.cmd == IOS_OPEN && reply >= 0)
+        reply = AllocFile(HostFileKind::Manager, pending->queue, reply);
+
+    pending->req.result = reply;
+
+    if (pending->asyncMsg == nullptr)
+        return IOS_SendMessage(pending->replyQueue, 0, 0);
+
+    ReplyAsync(pending->asyncMsg, pending->replyQueue, reply);
+    delete pending;
+    return IOS_SUCCESS;
+}
+
+static s32 Open(const char* path, u32 mode, s32 queue_id, IOSRequest* msg)
+{
+    s32 ret = IOS_ENOENT;
+    if (strcmp(path, "/dev/aes") == 0) {
+        ret = AllocFile(HostFileKind::AES, -1, 0);
+    } else if (strcmp(path, "/dev/sha") == 0) {
+        ret = AllocFile(HostFileKind::SHA, -1, 0);
+    } else {
+        for (u32 i = 0; i < s_managerCount; i++) {
+            if (strcmp(path, s_managers[i].path) != 0)
+                continue;
+
+            IOSRequest req = {};
+            req.cmd = IOS_OPEN;
+            req.open.path = const_cast<char*>(path);
+            req.open.mode = mode;
+            return ManagerRequest(s_managers[i].queue, &req, queue_id, msg);
+        }
+    }
+
+    if (msg == nullptr)
+        return ret;
+
+    ReplyAsync(msg, queue_id, ret);
+    return IOS_SUCCESS;
+}
+
+s32 IOS_Open(const char* path, u32 mode)
+{
+    return Open(path, mode, -1, nullptr);
+}
+
+s32 IOS_OpenAsync(const char* path, u32 mode, s32 queue_id, IOSRequest* msg)
+{
+    return Open(path, mode, queue_id, msg);
+}
+
+s32 IOS_Close(s32 fd)
+{
+    IOSRequest req = {};
+    req.cmd = IOS_CLOSE;
+    return Submit(fd, &req, -1, nullptr);
+}
+
+s32 IOS_CloseAsync(s32 fd, s32 queue_id, IOSRequest* msg)
+{
+    IOSRequest req = {};
+    req.cmd = IOS_CLOSE;
+    return Submit(fd, &req, queue_id, msg);
+}
+
+static s32 Seek(s32 fd, s32 where, s32 whence, s32 queue_id, IOSRequest* msg)
+{
+    IOSRequest req = {};
+    req.cmd = IOS_SEEK;
+    req.seek.where = where;
+    req.seek.whence = whence;
+    return Submit(fd, &req, queue_id, msg);
+}
+
+s32 IOS_Seek(s32 fd, s32 where, s32 whence)
+{
+    return Seek(fd, where, whence, -1, nullptr);
+}
+
+s32 IOS_SeekAsync(s32 fd, s32 where, s32 whence, s32 queue_id, IOSRequest* msg)
+{
+    return Seek(fd, where, whence, queue_id, msg);
+}
+
+static s32 ReadWrite(u32 cmd, s32 fd, const void* buf, s32 len, s32 queue_id,
+                     IOSRequest* msg)
+{
+    IOSRequest req = {};
+    req.cmd = cmd;
+    req.read.data = const_cast<void*>(buf);
+    req.read.len = len;
+    return Submit(fd, &req, queue_id, msg);
+}
+
+s32 IOS_Read(s32 fd, void* buf, s32 len)
+{
+    return ReadWrite(IOS_READ, fd, buf, len, -1, nullptr);
+}
+
+s32 IOS_ReadAsync(s32 fd, void* buf, s32 len, s32 queue_id, IOSRequest* msg)
+{
+    return ReadWrite(IOS_READ, fd, buf, len, queue_id, msg);
+}
+
+s32 IOS_Write(s32 fd, const void* buf, s32 len)
+{
+    return ReadWrite(IOS_WRITE, fd, buf, len, -1, nullptr);
+}
+
+s32 IOS_WriteAsync(s32 fd, const void* buf, s32 len, s32 queue_id,
+                   IOSRequest* msg)
+{
+    return ReadWrite(IOS_WRITE, fd, buf, len, queue_id, msg);
+}
+
+static s32 Ioctl(s32 fd, u32 command, void* in, u32 in_len, void* io,
+                 u32 io_len, s32 queue_id, IOSRequest* msg)
+{
+    IOSRequest req = {};
+    req.cmd = IOS_IOCTL;
+    req.ioctl.cmd = command;
+    req.ioctl.in = in;
+    req.ioctl.in_len = in_len;
+    req.ioctl.io = io;
+    req.ioctl.io_len = io_len;
+    return Submit(fd, &req, queue_id, msg);
+}
+
+s32 IOS_Ioctl(s32 fd, u32 command, void* in, u32 in_len, void* io, u32 io_len)
+{
+    return Ioctl(fd, command, in, in_len, io, io_len, -1, nullptr);
+}
+
+s32 IOS_IoctlAsync(s32 fd, u32 command, void* in, u32 in_len, void* io,
+                   u32 io_len, s32 queue_id, IOSRequest* msg)
+{
+    return Ioctl(fd, command, in, in_len, io, io_len, queue_id, msg);
+}
+
+static s32 Ioctlv(s32 fd, u32 command, u32 in_cnt, u32 out_cnt, IOVector* vec,
+                  s32 queue_id, IOSRequest* msg)
+{
+    IOSRequest req = {};
+    req.cmd = IOS_IOCTLV;
+    req.ioctlv.cmd = command;
+    req.ioctlv.in_count = in_cnt;
+    req.ioctlv.io_count = out_cnt;
+    req.ioctlv.vec = vec;
+    return Submit(fd, &req, queue_id, msg);
+}
+
+s32 IOS_Ioctlv(s32 fd, u32 command, u32 in_cnt, u32 out_cnt, IOVector* vec)
+{
+    return Ioctlv(fd, command, in_cnt, out_cnt, vec, -1, nullptr);
+}
+
+s32 IOS_IoctlvAsync(s32 fd, u32 command, u32 in_cnt, u32 out_cnt, IOVector* vec,
+                    s32 queue_id, IOSRequest* msg)
+{
+    return Ioctlv(fd, command, in_cnt, out_cnt, vec, queue_id, msg);
+}
+
+/* <----------
+ * ARM Memory and Cache
+ * ----------> */
+void IOS_InvalidateDCache(void* address, u32 size)
+{
+}
+
+void IOS_FlushDCache(const void* address, u32 size)
+{
+}
+
+void* IOS_VirtualToPhysical(void* virt)
+{
+    return virt;
+}
+
+/* <----------
+ * Misc IOS
+ * ----------> */
+s32 IOS_SetPPCACRPerms(u8 enable)
+{
+    return IOS_SUCCESS;
+}
+
+s32 IOS_SetIpcAccessRights(u8* rights)
+{
+    return IOS_SUCCESS;
+}
+
+s32 IOS_SetUid(u32 pid, u32 uid)
+{
+    return IOS_SUCCESS;
+}
+
+u32 IOS_GetUid()
+{
+    return 0;
+}
+
+s32 IOS_SetGid(u32 pid, u16 gid)
+{
+    return IOS_SUCCESS;
+}
+
+u16 IOS_GetGid()
+{
+    return 0;
+}
+
+s32 IOS_LaunchElf(const char* path)
+{
+    return IOS_EACCES;
+}
+
+s32 IOS_LaunchRM(const char* path)
+{
+    return IOS_EACCES;
+}
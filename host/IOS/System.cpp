@@ -0,0 +1,54 @@
+// System.cpp - Saoirse IOS system for the host build
+//
+// SPDX-License-Identifier: MIT
+
+#include "MMIO.hpp"
+#include <IOS/System.hpp>
+#include <System/Types.h>
+#include <time.h>
+
+s32 System::s_heapId = -1;
+void* System::s_dolData = nullptr;
+u32 System::s_dolSize = 0;
+u8 System::s_dolHash[0x14] = {};
+
+// PPC MEM1, written by the DOL loader. Kept in .bss so it stays below
+// 0x80000000 like PPC physical addresses.
+u8 g_hostMEM1[0x01800000] ATTRIBUTE_ALIGN(32);
+
+void System::SetTime(u32 hwTimerVal, u64 epoch)
+{
+    // The host clock is always right
+}
+
+u64 System::GetTime()
+{
+    return time(nullptr);
+}
+
+u32 AtomicSwap(volatile u32* ptr, u32 value)
+{
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+// The interrupt mask only matters to the engine model
+static bool s_irqsMasked = false;
+
+u32 IRQDisable()
+{
+    const u32 cpsr = 0x1F | (s_irqsMasked ? 0xC0 : 0);
+    s_irqsMasked = true;
+    MMIO::SetIRQsMasked(true);
+    return cpsr;
+}
+
+void IRQRestore(u32 cpsr)
+{
+    s_irqsMasked = cpsr & 0x80;
+    MMIO::SetIRQsMasked(s_irqsMasked);
+}
+
+u32 ReadCPSR()
+{
+    return 0x1F | (s_irqsMasked ? 0xC0 : 0);
+}
@@ -0,0 +1,146 @@
+// Main.cpp - Host driver for the IOS storage stack
+//
+// SPDX-License-Identifier: MIT
+
+#include <Debug/Log.hpp>
+#include <Disk/DeviceMgr.hpp>
+#include <Disk/DiskImage.hpp>
+#include <EmuSDIO/EmuSDIO.hpp>
+#include <EmuSDIO/TraceReplay.hpp>
+#include <IOS/IPCLog.hpp>
+#include <IOS/Syscalls.h>
+#include <IOS/System.hpp>
+#include <System/AES.hpp>
+#include <System/EngineCheck.hpp>
+#include <System/Config.hpp>
+#include <System/MemStats.hpp>
+#include <System/OS.hpp>
+#include <System/SHA.hpp>
+#include <System/Slab.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+
+/*
+ * Brings up the same services as the IOS module's Entry and SystemThreadEntry
+ * on top of disk images, then waits for the channel DOLs to be loaded from
+ * the blob into the emulated MEM1.
+ */
+
+constexpr u32 SystemHeapSize = 0x40000; // 256 KB
+
+static u64 GetUsec()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return u64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void Usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [-s sd.img] [-u usb.img]... [-t timeout_ms] [-b] "
+            "[-r trace.bin] [-e]\n"
+            "  -s  SD card image\n"
+            "  -u  USB mass storage image, may be given up to %u times\n"
+            "  -t  How long to wait for the channel to load, default 10000\n"
+            "  -b  Run the storage benchmark before loading the channel\n"
+            "  -r  Replay an SDIO trace once the channel is loaded\n"
+            "  -e  Check the engine drivers against software crypto and "
+            "exit\n",
+            name, DiskImage::MaxUSBImages);
+}
+
+int main(int argc, char** argv)
+{
+    u32 timeoutMs = 10000;
+    bool storageBench = false;
+    bool engineCheck = false;
+    const char* tracePath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0) {
+            storageBench = true;
+            continue;
+        }
+
+        if (strcmp(argv[i], "-e") == 0) {
+            engineCheck = true;
+            continue;
+        }
+
+        if (i + 1 >= argc || argv[i][0] != '-' || argv[i][2] != '\0') {
+            Usage(argv[0]);
+            return 2;
+        }
+
+        const char* arg = argv[++i];
+        switch (argv[i - 1][1]) {
+        case 's':
+            if (!DiskImage::s_sdImage.Open(arg))
+                return 1;
+            break;
+
+        case 'u':
+            if (DiskImage::s_usbImageCount >= DiskImage::MaxUSBImages ||
+                !DiskImage::s_usbImages[DiskImage::s_usbImageCount].Open(arg))
+                return 1;
+            DiskImage::s_usbImageCount++;
+            break;
+
+        case 't':
+            timeoutMs = strtoul(arg, nullptr, 0);
+            break;
+
+        case 'r':
+            tracePath = arg;
+            break;
+
+        default:
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+
+    s32 ret = IOS_CreateHeap(nullptr, SystemHeapSize);
+    if (ret < 0)
+        return 1;
+    System::SetHeap(ret);
+
+    MemStats::Init(SystemHeapSize);
+    Slab::Init();
+    Config::sInstance = new Config();
+    Config::sInstance->m_storageBench = storageBench;
+    IPCLog::sInstance = new IPCLog();
+    Log::ipcLogEnabled = true;
+
+    SHA::sInstance = new SHA();
+    AES::sInstance = new AES();
+
+    if (engineCheck)
+        return EngineCheck::Run() ? 0 : 1;
+
+    const u64 startTime = GetUsec();
+    DeviceMgr::sInstance = new DeviceMgr();
+    new Thread(EmuSDIO::ThreadEntry, nullptr, nullptr, 0x2000, 80);
+
+    // Notify 0 is sent once the channel DOLs are in MEM1
+    s32 id;
+    do {
+        id = IPCLog::sInstance->WaitForNotify(timeoutMs * 1000);
+    } while (id > 0);
+
+    if (id < 0) {
+        printf("Timed out waiting for the channel to load\n");
+        return 1;
+    }
+
+    printf("Channel loaded in %llu us\n",
+           (unsigned long long)(GetUsec() - startTime));
+
+    if (tracePath != nullptr && !TraceReplay::Run(tracePath))
+        return 1;
+
+    return 0;
+}
@@ -0,0 +1,194 @@
+// EngineCheck.cpp - Checks the engine drivers against software crypto, host
+// build
+//
+// SPDX-License-Identifier: MIT
+
+#include "EngineCheck.hpp"
+#include <IOS/Crypto.hpp>
+#include <IOS/MMIO.hpp>
+#include <System/AESEngine.hpp>
+#include <System/SHAEngine.hpp>
+#include <System/OS.hpp>
+#include <System/Util.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace EngineCheck
+{
+
+// Spans several 64 KiB engine commands and a partial one
+static constexpr u32 MaxSize = 0x30000 + 0x40;
+
+// The engine DMA addresses are 32-bit, which .bss is known to fit in
+static u8 s_input[MaxSize] ATTRIBUTE_ALIGN(32);
+static u8 s_engineOut[MaxSize] ATTRIBUTE_ALIGN(32);
+static u8 s_softOut[MaxSize] ATTRIBUTE_ALIGN(32);
+
+static void Fill(u8* data, u32 size, u32 seed)
+{
+    for (u32 i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = seed >> 16;
+    }
+}
+
+/*
+ * A contended engine reads as busy for a few polls, which Crypt reports as
+ * NoAccess before it has touched anything. Retry so the engine path is what
+ * gets checked. Each retry restores the interrupts, letting IOSC move on.
+ */
+static s32 EngineCrypt(bool decrypt, const u8* key, u8* iv, const void* input,
+                       u32 size, void* output)
+{
+    s32 ret;
+    for (u32 i = 0; i < 8; i++) {
+        ret = AESEngine::Crypt(decrypt, key, iv, input, size, output);
+        if (ret != IOSError::NoAccess)
+            break;
+    }
+    return ret;
+}
+
+static s32 SoftCrypt(bool decrypt, const u8* key, u8* iv, const void* input,
+                     u32 size, void* output)
+{
+    u8 keyCopy[16];
+    memcpy(keyCopy, key, 16);
+
+    IOVector vec[4] = {
+        {const_cast<void*>(input), size},
+        {keyCopy, 16},
+        {output, size},
+        {iv, 16},
+    };
+    return Crypto::AESIoctlv(decrypt ? 3 : 2, 2, 2, vec);
+}
+
+/*
+ * Two calls back to back, so the IV handed back by the first is checked by
+ * the second.
+ */
+static bool CheckAES(bool decrypt, bool inPlace, u32 size)
+{
+    u8 key[16], engineIv[16], softIv[16];
+    Fill(key, 16, size);
+    Fill(engineIv, 16, ~size);
+    memcpy(softIv, engineIv, 16);
+
+    bool ok = true;
+    for (u32 call = 0; call < 2; call++) {
+        Fill(s_input, size, size * 2 + call);
+        if (inPlace)
+            memcpy(s_engineOut, s_input, size);
+
+        const s32 engineRet =
+            EngineCrypt(decrypt, key, engineIv,
+                        inPlace ? s_engineOut : s_input, size, s_engineOut);
+        const s32 softRet =
+            SoftCrypt(decrypt, key, softIv, s_input, size, s_softOut);
+
+        if (engineRet != IOSError::OK || softRet != IOS_SUCCESS) {
+            printf("AES: call %u failed: engine %d, software %d\n", call,
+                   engineRet, softRet);
+            ok = false;
+            break;
+        }
+
+        if (memcmp(s_engineOut, s_softOut, size) != 0 ||
+            memcmp(engineIv, softIv, 16) != 0) {
+            printf("AES: call %u output or IV differs\n", call);
+            ok = false;
+            break;
+        }
+    }
+
+    printf("AES %s %-12s 0x%05X: %s\n", decrypt ? "decrypt" : "encrypt",
+           inPlace ? "in place" : "out of place", size, ok ? "OK" : "FAIL");
+    return ok;
+}
+
+static bool SoftSHA(const u8* data, u32 size, u8* hashOut)
+{
+    Crypto::SHAContext ctx;
+    IOVector vec[3] = {
+        {const_cast<u8*>(data), size},
+        {&ctx, sizeof(ctx)},
+        {hashOut, 0x14},
+    };
+    return Crypto::SHAIoctlv(0, 1, 2, vec) == IOS_SUCCESS &&
+           Crypto::SHAIoctlv(2, 1, 2, vec) == IOS_SUCCESS;
+}
+
+/*
+ * Hash in 64 KiB updates. The offset makes the input unaligned, which goes
+ * through the bounce buffer instead.
+ */
+static bool CheckSHA(u32 size, u32 offset)
+{
+    static constexpr u32 SliceSize = 0x10000;
+
+    Fill(s_input, size + offset, size);
+    const u8* in = s_input + offset;
+
+    u8 softHash[0x14];
+    if (!SoftSHA(in, size, softHash)) {
+        printf("SHA: software hash failed\n");
+        return false;
+    }
+
+    // Static as well, the final blocks are hashed from the context buffer
+    static SHAEngine::Context ctx;
+    u8 engineHash[0x14];
+    s32 ret = SHAEngine::Init(&ctx);
+    for (u32 pos = 0; pos < size && ret == IOSError::OK; pos += SliceSize) {
+        const u32 len = std::min(size - pos, SliceSize);
+        ret = SHAEngine::Update(&ctx, in + pos, len);
+    }
+    if (ret == IOSError::OK)
+        ret = SHAEngine::Final(&ctx, engineHash);
+
+    const bool ok =
+        ret == IOSError::OK && memcmp(engineHash, softHash, 0x14) == 0;
+    printf("SHA %s 0x%05X: %s\n", offset ? "unaligned" : "aligned  ", size,
+           ok ? "OK" : "FAIL");
+    return ok;
+}
+
+bool Run()
+{
+    static const u32 Sizes[] = {0x20, 0x10000, 0x10020, MaxSize};
+    static const u32 SHASizes[] = {0, 0x37, 0x40, 0x10000, 0x20001,
+                                   MaxSize - 0x40};
+
+    MMIO::SetEnginesEnabled(true);
+
+    bool ok = true;
+    for (u32 contention = 0; contention < 2; contention++) {
+        printf("IOSC contention %s\n", contention ? "on" : "off");
+        MMIO::SetContention(contention);
+
+        for (u32 size : Sizes) {
+            for (u32 decrypt = 0; decrypt < 2; decrypt++) {
+                for (u32 inPlace = 0; inPlace < 2; inPlace++)
+                    ok &= CheckAES(decrypt, inPlace, size);
+            }
+        }
+
+        for (u32 size : SHASizes) {
+            for (u32 offset : {0, 4})
+                ok &= CheckSHA(size, offset);
+        }
+
+        if (MMIO::IOSCDisturbed()) {
+            printf("IOSC was disturbed\n");
+            ok = false;
+        }
+    }
+
+    MMIO::SetContention(false);
+    MMIO::SetEnginesEnabled(false);
+    return ok;
+}
+
+} // namespace EngineCheck
@@ -0,0 +1,19 @@
+// EngineCheck.hpp - Checks the engine drivers against software crypto, host
+// build
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/*
+ * Runs AESEngine and SHAEngine on the MMIO model and compares every result
+ * with the software /dev/aes and /dev/sha, with and without IOSC contention
+ * between commands. Prints each mismatch and returns whether everything
+ * matched.
+ */
+namespace EngineCheck
+{
+
+bool Run();
+
+} // namespace EngineCheck
@@ -0,0 +1,146 @@
+// MemCheck.c - Checks System/Memory.s against newlib, run under ARM emulation
+//
+// SPDX-License-Identifier: MIT
+
+// Built by memcheck.mk, not part of the host build. Every destination and
+// source offset within a cache line is run with every tail length, through
+// the byte path, the word and burst paths and the whole sector path. The
+// result has to match newlib's memcpy and memset, the versions Memory.s
+// replaced, byte for byte including the guard bytes around it.
+
+#include <System/Types.h>
+#include <stdio.h>
+#include <string.h>
+
+// Memory.s, renamed by memcheck.mk so newlib's versions still link
+void* burst_memcpy(void* dst, const void* src, size_t len);
+void* burst_memset(void* dst, int value, size_t len);
+
+#define LINE_SIZE 32
+// Room for the largest offset and tail, and guard bytes either side
+#define GUARD_SIZE 64
+#define MAX_LEN (4096 + LINE_SIZE)
+#define BUFFER_SIZE (GUARD_SIZE + LINE_SIZE + MAX_LEN + GUARD_SIZE)
+
+static u8 s_src[BUFFER_SIZE] __attribute__((aligned(32)));
+static u8 s_dst[BUFFER_SIZE] __attribute__((aligned(32)));
+static u8 s_ref[BUFFER_SIZE] __attribute__((aligned(32)));
+
+static u32 s_rand = 0x4D454D43;
+
+static u8 Random(void)
+{
+    s_rand = s_rand * 1103515245 + 12345;
+    return s_rand >> 16;
+}
+
+static void Fill(u8* data, u32 size)
+{
+    for (u32 i = 0; i < size; i++)
+        data[i] = Random();
+}
+
+/*
+ * Every length up to three lines covers the byte path below 16 and the head
+ * and tail of the word and burst paths. The bigger ones add every tail to
+ * one and eight sectors, where aligned buffers take the sector path.
+ */
+static u32 GetLength(u32 i)
+{
+    if (i < 3 * LINE_SIZE)
+        return i;
+
+    i -= 3 * LINE_SIZE;
+    return (i < LINE_SIZE ? 512 : 4096) + i % LINE_SIZE;
+}
+
+#define LENGTH_COUNT (3 * LINE_SIZE + 2 * LINE_SIZE)
+
+/*
+ * Compare the destination and the guard bytes either side of it, which is
+ * all that was filled for this case.
+ */
+static int Check(const char* name, u32 dstOffset, u32 srcOffset, u32 len,
+                 const void* ret, const void* to)
+{
+    if (ret != to) {
+        printf("%s: wrong return value, dst +%u src +%u length %u\n", name,
+               dstOffset, srcOffset, len);
+        return 0;
+    }
+
+    if (memcmp(s_dst + dstOffset, s_ref + dstOffset,
+               GUARD_SIZE + len + GUARD_SIZE) != 0) {
+        printf("%s: wrong result, dst +%u src +%u length %u\n", name,
+               dstOffset, srcOffset, len);
+        return 0;
+    }
+
+    return 1;
+}
+
+static int CheckMemcpy(void)
+{
+    u32 count = 0;
+
+    Fill(s_src, BUFFER_SIZE);
+
+    for (u32 dstOffset = 0; dstOffset < LINE_SIZE; dstOffset++) {
+        for (u32 srcOffset = 0; srcOffset < LINE_SIZE; srcOffset++) {
+            for (u32 i = 0; i < LENGTH_COUNT; i++) {
+                const u32 len = GetLength(i);
+                u8* to = s_dst + GUARD_SIZE + dstOffset;
+                const u8* from = s_src + GUARD_SIZE + srcOffset;
+
+                Fill(to - GUARD_SIZE, GUARD_SIZE + len + GUARD_SIZE);
+                memcpy(s_ref + dstOffset, s_dst + dstOffset,
+                       GUARD_SIZE + len + GUARD_SIZE);
+
+                memcpy(s_ref + GUARD_SIZE + dstOffset, from, len);
+                const void* ret = burst_memcpy(to, from, len);
+                if (!Check("memcpy", dstOffset, srcOffset, len, ret, to))
+                    return 0;
+                count++;
+            }
+        }
+    }
+
+    printf("memcpy: %u cases OK\n", count);
+    return 1;
+}
+
+static int CheckMemset(void)
+{
+    // Only the low byte of the value is used
+    static const int Values[] = {0x00, 0xA5, 0x15A, -1};
+    u32 count = 0;
+
+    for (u32 dstOffset = 0; dstOffset < LINE_SIZE; dstOffset++) {
+        for (u32 i = 0; i < LENGTH_COUNT; i++) {
+            for (u32 v = 0; v < sizeof(Values) / sizeof(Values[0]); v++) {
+                const u32 len = GetLength(i);
+                u8* to = s_dst + GUARD_SIZE + dstOffset;
+
+                Fill(to - GUARD_SIZE, GUARD_SIZE + len + GUARD_SIZE);
+                memcpy(s_ref + dstOffset, s_dst + dstOffset,
+                       GUARD_SIZE + len + GUARD_SIZE);
+
+                memset(s_ref + GUARD_SIZE + dstOffset, Values[v], len);
+                const void* ret = burst_memset(to, Values[v], len);
+                if (!Check("memset", dstOffset, 0, len, ret, to))
+                    return 0;
+                count++;
+            }
+        }
+    }
+
+    printf("memset: %u cases OK\n", count);
+    return 1;
+}
+
+int main(void)
+{
+    int ok = CheckMemcpy();
+    ok &= CheckMemset();
+    return ok ? 0 : 1;
+}
@@ -103,6 +103,34 @@ CFLAGS	+=	 $(INCLUDE) -Os -DTARGET_IOS -DNDEBUG -Wall -Wextra -Wpedantic -Werror
 	-fverbose-asm -ffunction-sections -fdata-sections -fno-exceptions -Wno-pointer-arith -Wno-format-truncation
 CXXFLAGS = $(CFLAGS) -std=c++20 -fno-rtti -fno-builtin-memcpy -fno-builtin-memset -Wno-narrowing 
 
+# make STORAGE_BENCH=1 builds in and runs the storage benchmark, see Disk/StorageBench.hpp
+ifeq ($(STORAGE_BENCH),1)
+CFLAGS	+=	-DSTORAGE_BENCH
+endif
+
+# make PROFILER=1 samples the module's threads, see System/Profiler.hpp
+ifeq ($(PROFILER),1)
+CFLAGS	+=	-DPROFILER
+endif
+
+# make HEAP_STATS=1 accounts heap blocks by site, see System/MemStats.hpp
+ifeq ($(HEAP_STATS),1)
+CFLAGS	+=	-DHEAP_STATS
+endif
+
+# make SDIO_TRACE=1 records EmuSDIO accesses, see EmuSDIO/SDIOTrace.hpp
+ifeq ($(SDIO_TRACE),1)
+CFLAGS	+=	-DSDIO_TRACE
+endif
+
+# make DOL_CACHE=1 keeps the loaded channel DOLs in the IPC heap, see CTGP/Blob.cpp
+ifeq ($(DOL_CACHE),1)
+CFLAGS	+=	-DDOL_CACHE
+endif
+
+# make LOG_LEVELS="IOS_EmuSDIO=WARN" overrides Debug/LogConfig.hpp
+CFLAGS	+=	$(foreach level,$(LOG_LEVELS),-DLOG_LEVEL_$(level))
+
 ifeq ($(COMPILER),clang)
 AFLAGS	=	$(CLANG_ARCH) -x assembler-with-cpp
 else
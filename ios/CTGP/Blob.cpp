@@ -4,12 +4,17 @@
 // SPDX-License-Identifier: MIT
 
 #include "Blob.hpp"
+#include <Debug/BootTimeline.h>
 #include <Debug/Log.hpp>
+#include <Disk/DeviceMgr.hpp>
 #include <EmuSDIO/EmuSDIO.hpp>
 #include <IOS/IPCLog.hpp>
 #include <IOS/Patch.hpp>
 #include <System/AES.hpp>
+#include <System/OS.hpp>
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <cstring>
 
 static const u8 BlobKey[] alignas(32) = {
@@ -63,11 +68,11 @@ void Blob::Reset()
 static void blobEncodeIv(u32 sector, u8* iv)
 {
     memcpy(iv, BlobIv, sizeof(BlobIv));
-    u8* sectorVal = (u8*)&sector;
-    iv[8] = sectorVal[0];
-    iv[9] = sectorVal[1];
-    iv[10] = sectorVal[2];
-    iv[11] = sectorVal[3];
+    // Big endian sector number
+    iv[8] = sector >> 24;
+    iv[9] = sector >> 16;
+    iv[10] = sector >> 8;
+    iv[11] = sector;
 }
 
 void BlobDecrypt(void* data, u8* iv, u32 sectorCount)
@@ -179,6 +184,194 @@ struct DOL {
 
 bool stubMode = false;
 
+// Get a pointer to a PPC physical or effective address in MEM1
+static inline void* MEM1Ptr(u32 addr)
+{
+    return MEM1_BASE + (addr & 0x7FFFFFFF);
+}
+
+/*
+ * With DOL_CACHE, the loaded channel DOLs are kept in IOS memory after the
+ * first launch, so a relaunch after a blocked IOS reload is a bulk copy
+ * instead of reading and decrypting them from the blob again. The image is
+ * only reused if both files still have the same size, start cluster and
+ * write time.
+ *
+ * The ranges are recorded in every build, and the size the image would take
+ * is written to log.txt. It hasn't been measured for the shipped DOLs yet, so
+ * the cache isn't built in by default.
+ */
+struct DOLCacheKey {
+    FSIZE_t size;
+    DWORD sclust;
+    DWORD mtime;
+
+    bool operator==(const DOLCacheKey& rhs) const
+    {
+        return size == rhs.size && sclust == rhs.sclust && mtime == rhs.mtime;
+    }
+};
+
+struct DOLCacheRange {
+    u32 addr;
+    u32 size;
+    // Zero filled, otherwise the data is stored in the image
+    bool zero;
+};
+
+// BSS, sections, entry point and boot data for both DOLs, and stub patches
+static constexpr u32 DOLCacheMaxRanges = 2 * (1 + 7 + 11 + 2) + 2;
+
+/*
+ * The image comes out of the IPC heap, which every other module shares, so
+ * it's capped; a bigger image is just loaded from the blob every time. The
+ * buffer is kept and reused for the next image that fits.
+ */
+static constexpr u32 DOLCacheMaxSize = 0x80000;
+
+static struct {
+    bool recording;
+    bool valid;
+    DOLCacheKey stubKey;
+    DOLCacheKey mainKey;
+    u32 rangeCount;
+    DOLCacheRange ranges[DOLCacheMaxRanges];
+    u8* data;
+    u32 dataCapacity;
+} s_dolCache;
+
+static void DOLCacheRecord(u32 addr, u32 size, bool zero)
+{
+    if (!s_dolCache.recording)
+        return;
+
+    if (s_dolCache.rangeCount >= DOLCacheMaxRanges) {
+        s_dolCache.recording = false;
+        return;
+    }
+
+    s_dolCache.ranges[s_dolCache.rangeCount++] = {
+        .addr = addr,
+        .size = size,
+        .zero = zero,
+    };
+}
+
+// From the directory entry FatFS read on open, so it costs no extra I/O
+static DOLCacheKey GetDOLCacheKey(const FIL* file)
+{
+    return {
+        .size = file->obj.objsize,
+        .sclust = file->obj.sclust,
+        .mtime = file->mtime,
+    };
+}
+
+static void DOLCacheBegin()
+{
+    s_dolCache.valid = false;
+    s_dolCache.rangeCount = 0;
+    s_dolCache.recording = true;
+}
+
+/*
+ * Copy everything the loaders wrote back out of MEM1. Taken after all
+ * patches are applied, so restoring the zero fills first and the data after
+ * gives the same result.
+ */
+static void DOLCacheFinish(const DOLCacheKey& stubKey,
+                           const DOLCacheKey& mainKey)
+{
+    if (!s_dolCache.recording)
+        return;
+    s_dolCache.recording = false;
+
+    u32 dataSize = 0;
+    for (u32 i = 0; i < s_dolCache.rangeCount; i++) {
+        if (!s_dolCache.ranges[i].zero)
+            dataSize += round_up(s_dolCache.ranges[i].size, 32);
+    }
+
+    if (DeviceMgr::sInstance->IsLogEnabled()) {
+        char line[64];
+        u32 len =
+            snprintf(line, sizeof(line), "DOL cache: %u bytes in %u ranges",
+                     dataSize, s_dolCache.rangeCount);
+        len = std::min<u32>(len, sizeof(line) - 1);
+        DeviceMgr::sInstance->WriteToLog(line, len);
+    }
+
+#ifdef DOL_CACHE
+    if (dataSize > DOLCacheMaxSize) {
+        PRINT(IOS_DevMgr, INFO, "DOLs too large to cache: %u", dataSize);
+        return;
+    }
+
+    if (dataSize > s_dolCache.dataCapacity) {
+        if (s_dolCache.data != nullptr) {
+            s32 ret = IOS_Free(IOS::ipcHeap, s_dolCache.data);
+            ASSERT(ret == IOSError::OK);
+        }
+
+        s_dolCache.dataCapacity = 0;
+        s_dolCache.data = reinterpret_cast<u8*>(
+            IOS_AllocAligned(IOS::ipcHeap, dataSize, 32));
+        if (s_dolCache.data == nullptr) {
+            PRINT(IOS_DevMgr, WARN, "Not enough memory to cache the DOLs: %u",
+                  dataSize);
+            return;
+        }
+        s_dolCache.dataCapacity = dataSize;
+    }
+
+    u8* data = s_dolCache.data;
+    for (u32 i = 0; i < s_dolCache.rangeCount; i++) {
+        const auto& range = s_dolCache.ranges[i];
+        if (range.zero)
+            continue;
+
+        memcpy(data, MEM1Ptr(range.addr), range.size);
+        data += round_up(range.size, 32);
+    }
+
+    s_dolCache.stubKey = stubKey;
+    s_dolCache.mainKey = mainKey;
+    s_dolCache.valid = true;
+#endif
+}
+
+#ifdef DOL_CACHE
+static bool DOLCacheRestore(const DOLCacheKey& stubKey,
+                            const DOLCacheKey& mainKey)
+{
+    if (!s_dolCache.valid || !(s_dolCache.stubKey == stubKey) ||
+        !(s_dolCache.mainKey == mainKey))
+        return false;
+
+    for (u32 i = 0; i < s_dolCache.rangeCount; i++) {
+        const auto& range = s_dolCache.ranges[i];
+        if (!range.zero)
+            continue;
+
+        memset(MEM1Ptr(range.addr), 0, range.size);
+        IOS_FlushDCache(MEM1Ptr(range.addr), range.size);
+    }
+
+    const u8* data = s_dolCache.data;
+    for (u32 i = 0; i < s_dolCache.rangeCount; i++) {
+        const auto& range = s_dolCache.ranges[i];
+        if (range.zero)
+            continue;
+
+        memcpy(MEM1Ptr(range.addr), data, range.size);
+        IOS_FlushDCache(MEM1Ptr(range.addr), range.size);
+        data += round_up(range.size, 32);
+    }
+
+    return true;
+}
+#endif
+
 bool Blob::LaunchDOL(FIL* dolFile)
 {
     DOL dol ATTRIBUTE_ALIGN(32);
@@ -190,6 +383,13 @@ bool Blob::LaunchDOL(FIL* dolFile)
         return false;
     }
 
+#ifdef TARGET_HOST
+    // The header is big endian
+    u32* words = reinterpret_cast<u32*>(&dol);
+    for (u32 i = 0; i < sizeof(DOL) / 4; i++)
+        words[i] = bswap32(words[i]);
+#endif
+
     // Verify DOL header
     if (dol.dol_sect[0] != 0x00000100) {
         // Yeah... I guess that's enough, right?
@@ -197,10 +397,10 @@ bool Blob::LaunchDOL(FIL* dolFile)
         return false;
     }
 
-    memset((void*)(dol.dol_bss_addr & 0x7FFFFFFF), 0,
-           round_up(dol.dol_bss_size, 32));
-    IOS_FlushDCache((void*)(dol.dol_bss_addr & 0x7FFFFFFF),
-                    round_up(dol.dol_bss_size, 32));
+    memset(MEM1Ptr(dol.dol_bss_addr), 0, round_up(dol.dol_bss_size, 32));
+    IOS_FlushDCache(MEM1Ptr(dol.dol_bss_addr), round_up(dol.dol_bss_size, 32));
+    DOLCacheRecord(dol.dol_bss_addr & 0x7FFFFFFF,
+                   round_up(dol.dol_bss_size, 32), true);
 
     // In stub mode only read the first section
     for (int i = 0; stubMode ? i < 1 : i < 7 + 11; i++) {
@@ -215,7 +415,7 @@ bool Blob::LaunchDOL(FIL* dolFile)
                 return false;
             }
 
-            fret = f_read(dolFile, (void*)(dol.dol_sect_addr[i] & 0x7FFFFFFF),
+            fret = f_read(dolFile, MEM1Ptr(dol.dol_sect_addr[i]),
                           dol.dol_sect_size[i], &br);
             if (fret != FR_OK) {
                 PRINT(IOS_DevMgr, INFO,
@@ -224,20 +424,24 @@ bool Blob::LaunchDOL(FIL* dolFile)
                 return false;
             }
 
-            IOS_FlushDCache((void*)(dol.dol_sect_addr[i] & 0x7FFFFFFF),
+            IOS_FlushDCache(MEM1Ptr(dol.dol_sect_addr[i]),
                             dol.dol_sect_size[i]);
+            DOLCacheRecord(dol.dol_sect_addr[i] & 0x7FFFFFFF,
+                           dol.dol_sect_size[i], false);
         }
     }
 
-    write32(0x00003400, dol.dol_entry_point);
-    IOS_FlushDCache((void*)0x00003400, 4);
+    write32(MEM1Ptr(0x00003400), dol.dol_entry_point);
+    IOS_FlushDCache(MEM1Ptr(0x00003400), 4);
+    DOLCacheRecord(0x00003400, 4, false);
     PRINT(IOS_DevMgr, INFO, "Running for Wii, entry point = %08X",
           dol.dol_entry_point);
 
     // Copy boot data
-    memset((void*)0x00001000, 0, 0x100);
-    memcpy((void*)0x00001000, BootData, sizeof(BootData));
-    IOS_FlushDCache((void*)0x00001000, sizeof(BootData));
+    memset(MEM1Ptr(0x00001000), 0, 0x100);
+    memcpy(MEM1Ptr(0x00001000), BootData, sizeof(BootData));
+    IOS_FlushDCache(MEM1Ptr(0x00001000), sizeof(BootData));
+    DOLCacheRecord(0x00001000, 0x100, false);
 
     return true;
 }
@@ -251,6 +455,7 @@ bool Blob::LaunchMainDOL(u32 devId)
         return false;
 
     PRINT(IOS_DevMgr, INFO, "Opening channel main.dol");
+    BootTimeline::Stamp(BOOT_IOS_LOAD_DOL_START);
 
     u64 timeStart = System::GetTime();
 
@@ -269,6 +474,8 @@ bool Blob::LaunchMainDOL(u32 devId)
     // Attempt to read from blob.bin
     char str2[64] = "0:/packages/chan/stub.dol";
     str2[0] = devId + '0';
+    char str3[64] = "0:/packages/chan/main.dol";
+    str3[0] = devId + '0';
 
     fret = f_open(&dolFile, str2, FA_READ);
     if (fret != FR_OK) {
@@ -278,50 +485,74 @@ bool Blob::LaunchMainDOL(u32 devId)
 
     PRINT(IOS_DevMgr, INFO, "Successfully opened channel stub.dol");
 
+    FIL mainFile;
+    fret = f_open(&mainFile, str3, FA_READ);
+    if (fret != FR_OK) {
+        PRINT(IOS_DevMgr, ERROR, "Failed to open '%s' fresult=%d", str3, fret);
+        f_close(&dolFile);
+        return false;
+    }
+
+    PRINT(IOS_DevMgr, INFO, "Successfully opened channel main.dol");
+
+    const DOLCacheKey stubKey = GetDOLCacheKey(&dolFile);
+    const DOLCacheKey mainKey = GetDOLCacheKey(&mainFile);
+
+#ifdef DOL_CACHE
+    if (DOLCacheRestore(stubKey, mainKey)) {
+        PRINT(IOS_DevMgr, INFO, "Restored channel DOLs from cache");
+        f_close(&mainFile);
+        f_close(&dolFile);
+        BootTimeline::Stamp(BOOT_IOS_LOAD_DOL_DONE);
+        EmuSDIO::g_emuDevId = m_devId;
+        IPCLog::sInstance->Notify(0);
+        return true;
+    }
+#endif
+
+    DOLCacheBegin();
+
     stubMode = true;
     dolret = LaunchDOL(&dolFile);
     PRINT(IOS_DevMgr, INFO, "dolret: %d", dolret);
+    if (!dolret)
+        s_dolCache.recording = false;
 
     // Some stub patches required for room sync
     const u32 stubBase = 0x4000;
-    write32(stubBase + 0x5E98, 0x4E800020);
-    IOS_FlushDCache((void*)(stubBase + 0x5E98), 4);
-    write32(stubBase + 0x5EA0, 0x4E800020);
-    IOS_FlushDCache((void*)(stubBase + 0x5EA0), 4);
+    write32(MEM1Ptr(stubBase + 0x5E98), 0x4E800020);
+    IOS_FlushDCache(MEM1Ptr(stubBase + 0x5E98), 4);
+    DOLCacheRecord(stubBase + 0x5E98, 4, false);
+    write32(MEM1Ptr(stubBase + 0x5EA0), 0x4E800020);
+    IOS_FlushDCache(MEM1Ptr(stubBase + 0x5EA0), 4);
+    DOLCacheRecord(stubBase + 0x5EA0, 4, false);
 
     f_close(&dolFile);
 
-    char str3[64] = "0:/packages/chan/main.dol";
-    str3[0] = devId + '0';
-
-    fret = f_open(&dolFile, str3, FA_READ);
-    if (fret != FR_OK) {
-        PRINT(IOS_DevMgr, ERROR, "Failed to open '%s' fresult=%d", str3, fret);
-        return false;
-    }
-
-    PRINT(IOS_DevMgr, INFO, "Successfully opened channel main.dol");
-
     // FatFS fast seek feature
     // Use FatFS fast seek function to speed up long backwards seeks
     // Distribute cluster map equally across the two parts
     clmtSize = sizeof(dolClmt) / sizeof(DWORD);
 
-    dolFile.cltbl = dolClmt;
+    mainFile.cltbl = dolClmt;
     dolClmt[0] = clmtSize;
 
-    fret = f_lseek(&dolFile, CREATE_LINKMAP);
+    fret = f_lseek(&mainFile, CREATE_LINKMAP);
 
     stubMode = false;
-    dolret = LaunchDOL(&dolFile);
+    dolret = LaunchDOL(&mainFile);
     PRINT(IOS_DevMgr, INFO, "dolret: %d", dolret);
 
-    f_close(&dolFile);
+    f_close(&mainFile);
 
     u64 timeEnd = System::GetTime();
-    PRINT(IOS_DevMgr, INFO, "Time elapsed: %lld", timeEnd - timeStart);
+    BootTimeline::Stamp(BOOT_IOS_LOAD_DOL_DONE);
+    PRINT(IOS_DevMgr, INFO, "Time elapsed: %lld",
+          (long long)(timeEnd - timeStart));
 
     if (dolret) {
+        DOLCacheFinish(stubKey, mainKey);
+
         EmuSDIO::g_emuDevId = m_devId;
         IPCLog::sInstance->Notify(0);
     }
@@ -5,8 +5,10 @@
 
 #include "DeviceMgr.hpp"
 #include <CTGP/Blob.hpp>
+#include <Debug/BootTimeline.h>
 #include <Debug/Log.hpp>
 #include <Disk/SDCard.hpp>
+#include <Disk/StorageBench.hpp>
 #include <IOS/IPCLog.hpp>
 #include <System/Config.hpp>
 #include <System/Types.h>
@@ -17,6 +19,9 @@ DeviceMgr* DeviceMgr::sInstance;
 
 DeviceMgr::DeviceMgr()
 {
+    m_logEnabled = false;
+    m_logDevice = DeviceCount;
+
     // 64 ms repeating timer
     m_timer = IOS_CreateTimer(0, 64000, m_timerQueue.id(), 0);
     assert(m_timer >= 0);
@@ -602,8 +607,15 @@ void DeviceMgr::UpdateHandle(u32 devId)
                 m_launchError = LaunchError::NoCTGPR;
             } else {
                 PRINT(IOS_DevMgr, INFO, "Blob mounted successfully");
+                BootTimeline::Stamp(BOOT_IOS_BLOB_MOUNTED);
                 m_devices[8].inserted = true;
                 m_devices[8].error = false;
+
+#ifdef STORAGE_BENCH
+                // Before the channel is loaded, so nothing else is reading
+                if (Config::sInstance->IsStorageBenchEnabled())
+                    StorageBench::Run(devId, 8, f_size(&blob.m_fil) / 512);
+#endif
                 UpdateHandle(8);
             }
         } else {
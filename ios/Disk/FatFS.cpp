@@ -8,6 +8,7 @@
 #include <FAT/diskio.h>
 #include <FAT/ff.h>
 #include <System/OS.hpp>
+#include <System/Slab.hpp>
 #include <limits>
 #include <tuple>
 
@@ -99,48 +100,34 @@ constexpr std::tuple<Int, unsigned, unsigned> civil_from_days(Int z) noexcept
 
 DWORD get_fattime()
 {
-    struct {
-        u32 year : 7;
-        u32 month : 4;
-        u32 day : 5;
-        u32 hour : 5;
-        u32 minute : 6;
-        u32 second : 5;
-    } fattime;
-
     u64 time64 = System::GetTime();
     u32 time32 = time64;
 
     s32 days = time64 / 86400;
     auto date = civil_from_days(days);
 
-    fattime = {
-        .year = std::get<0>(date) - 1980,
-        .month = std::get<1>(date),
-        .day = std::get<2>(date),
-        .hour = (time32 / 60 / 60) % 24,
-        .minute = (time32 / 60) % 60,
-        .second = time32 % 60,
-    };
-
-    DWORD* retval = (DWORD*)(&fattime);
-    return *retval;
+    // Packed with shifts rather than a bitfield so it doesn't depend on the
+    // bitfield order of the target
+    return (DWORD(std::get<0>(date) - 1980) << 25) |
+           (DWORD(std::get<1>(date)) << 21) | (DWORD(std::get<2>(date)) << 16) |
+           (DWORD((time32 / 60 / 60) % 24) << 11) |
+           (DWORD((time32 / 60) % 60) << 5) | DWORD((time32 % 60) / 2);
 }
 
 void* ff_memalloc(UINT msize)
 {
-    return new u8[msize];
+    return Slab::Alloc(msize, Slab::Heap::System);
 }
 
 void ff_memfree(void* mblock)
 {
-    u8* data = reinterpret_cast<u8*>(mblock);
-    delete[] data;
+    Slab::Free(mblock, Slab::Heap::System);
 }
 
 int ff_cre_syncobj([[maybe_unused]] BYTE vol, FF_SYNC_t* sobj)
 {
-    Mutex* mutex = new Mutex;
+    void* block = Slab::Alloc(sizeof(Mutex), Slab::Heap::System);
+    Mutex* mutex = new (block) Mutex;
     *sobj = reinterpret_cast<FF_SYNC_t>(mutex);
     return 1;
 }
@@ -163,6 +150,7 @@ void ff_rel_grant(FF_SYNC_t sobj)
 int ff_del_syncobj(FF_SYNC_t sobj)
 {
     Mutex* mutex = reinterpret_cast<Mutex*>(sobj);
-    delete mutex;
+    mutex->~Mutex();
+    Slab::Free(mutex, Slab::Heap::System);
     return 1;
 }
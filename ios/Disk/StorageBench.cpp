@@ -0,0 +1,359 @@
+// StorageBench.cpp - Sector-level storage benchmark
+//
+// SPDX-License-Identifier: MIT
+
+#ifdef STORAGE_BENCH
+
+#include "StorageBench.hpp"
+#include <Disk/DeviceMgr.hpp>
+#include <FAT/ff.h>
+#include <IOS/Syscalls.h>
+#include <System/OS.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <stdarg.h>
+
+namespace StorageBench
+{
+
+constexpr u32 SectorSize = 512;
+constexpr u32 MaxBufferSize = 1024 * 1024;
+constexpr u32 MinBufferSize = 32 * 1024;
+constexpr u32 MaxOps = 1024;
+
+// Bytes read by each sequential workload, fewer if MaxOps is hit first
+constexpr u32 SeqTotalSize = 4 * 1024 * 1024;
+// Random reads are spread over at most this much of the volume
+constexpr u32 MaxSpanSectors = 256 * 1024 * 1024 / SectorSize;
+// Encryption block size of the blob, see Blob.cpp
+constexpr u32 BlobBlockSectors = 64;
+
+constexpr u32 Seed = 0x4D534321;
+
+// Sizes for the memcpy and memset workloads, each run with every head offset
+// and tail below
+constexpr u32 MemSizes[] = {32, 512, 4 * 1024, 16 * 1024};
+constexpr u32 MemOffsets[] = {0, 1, 2, 3, 4, 17, 31};
+constexpr u32 MemTails[] = {0, 1, 3, 31};
+// Bytes moved by each combination, repeating the call as needed
+constexpr u32 MemRepeatSize = 64 * 1024;
+// Largest offset and tail, and a guard byte either side
+constexpr u32 MemSlack = 31 + 31 + 2;
+
+struct Op {
+    u32 sector;
+    u32 count;
+};
+
+static u8* s_buffer;
+static u32 s_bufferSize;
+static u32 s_latency[MaxOps];
+static u32 s_rand;
+
+#ifndef TARGET_HOST
+static FIL s_logFile;
+static bool s_logOpened;
+#endif
+
+/*
+ * Write one line of results. On console this goes to log.txt, through the
+ * debug log if it's open, otherwise to the benchmarked device.
+ */
+static void Report(const char* format, ...)
+{
+    char line[128];
+
+    va_list args;
+    va_start(args, format);
+    u32 len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (len >= sizeof(line))
+        len = sizeof(line) - 1;
+
+#ifdef TARGET_HOST
+    printf("[StorageBench] %s\n", line);
+#else
+    if (DeviceMgr::sInstance->IsLogEnabled()) {
+        DeviceMgr::sInstance->WriteToLog(line, len);
+        return;
+    }
+
+    if (!s_logOpened)
+        return;
+
+    UINT bw = 0;
+    f_write(&s_logFile, line, len, &bw);
+    f_write(&s_logFile, "\n", 1, &bw);
+#endif
+}
+
+/*
+ * Deterministic for a given seed, which is all the workloads need.
+ */
+static u32 Random()
+{
+    s_rand = s_rand * 1664525 + 1013904223;
+    return s_rand >> 8;
+}
+
+static u32 TicksToUsec(u32 ticks)
+{
+    return u64(ticks) * 128 / 243;
+}
+
+template <class NextOp>
+static void RunWorkload(const char* name, u32 devId, u32 opCount,
+                        NextOp nextOp)
+{
+    s_rand = Seed;
+    opCount = std::min(opCount, MaxOps);
+
+    u64 bytes = 0;
+    u64 totalUsec = 0;
+
+    for (u32 i = 0; i < opCount; i++) {
+        const Op op = nextOp(i);
+
+        const u32 start = IOS_GetTime();
+        if (!DeviceMgr::sInstance->DeviceRead(devId, s_buffer, op.sector,
+                                              op.count)) {
+            Report("%s: read of %u sectors at %u failed", name, op.count,
+                   op.sector);
+            return;
+        }
+        const u32 usec = TicksToUsec(IOS_GetTime() - start);
+
+        s_latency[i] = usec;
+        totalUsec += usec;
+        bytes += op.count * SectorSize;
+    }
+
+    if (opCount == 0)
+        return;
+
+    std::sort(s_latency, s_latency + opCount);
+    const u32 p50 = s_latency[(opCount - 1) * 50 / 100];
+    const u32 p99 = s_latency[(opCount - 1) * 99 / 100];
+
+    totalUsec = std::max<u64>(totalUsec, 1);
+    // Bytes per microsecond is MB/s
+    const u32 rate = bytes * 100 / totalUsec;
+    const u32 iops = u64(opCount) * 1000000 / totalUsec;
+
+    Report("%-16s %5u ops %6u KiB %4u.%02u MB/s %6u IOPS p50 %6u us "
+           "p99 %6u us",
+           name, opCount, u32(bytes / 1024), rate / 100, rate % 100, iops,
+           p50, p99);
+}
+
+// Called through these so the compiler can't merge or drop repeated calls
+static void* (*volatile s_memcpy)(void*, const void*, size_t) = memcpy;
+static void* (*volatile s_memset)(void*, int, size_t) = memset;
+
+/*
+ * Time memcpy and memset, System/Memory.s on console and libc on the host.
+ * The aligned line is both pointers on a cache line and a whole number of
+ * lines; everything else goes in the unaligned line. Each result is checked
+ * byte by byte after it's timed, including the bytes either side.
+ */
+static void RunMemory(bool set)
+{
+    const char* name = set ? "memset" : "memcpy";
+    u8* const src = s_buffer;
+    u8* const dst = s_buffer + s_bufferSize / 2;
+
+    s_rand = Seed;
+    for (u32 i = 0; i < s_bufferSize / 2; i++)
+        src[i] = Random();
+
+    for (u32 size : MemSizes) {
+        if (size + MemSlack > s_bufferSize / 2) {
+            Report("Skipping %s %u B, buffer is %u KiB", name, size,
+                   s_bufferSize / 1024);
+            continue;
+        }
+
+        const u32 repeat = std::max<u32>(MemRepeatSize / size, 1);
+        // Aligned, then unaligned
+        u64 bytes[2] = {};
+        u64 totalUsec[2] = {};
+
+        for (u32 dstOffset : MemOffsets) {
+            for (u32 srcOffset : MemOffsets) {
+                if (set && srcOffset != 0)
+                    continue;
+
+                for (u32 tail : MemTails) {
+                    const u32 len = size + tail;
+                    u8* const to = dst + dstOffset;
+                    const u8* const from = src + srcOffset;
+                    to[-1] = 0xA5;
+                    to[len] = 0x5A;
+
+                    const u32 start = IOS_GetTime();
+                    for (u32 i = 0; i < repeat; i++) {
+                        if (set)
+                            s_memset(to, u8(i), len);
+                        else
+                            s_memcpy(to, from, len);
+                    }
+                    const u32 usec = TicksToUsec(IOS_GetTime() - start);
+
+                    const u32 type = dstOffset | srcOffset | tail ? 1 : 0;
+                    bytes[type] += u64(len) * repeat;
+                    totalUsec[type] += usec;
+
+                    bool ok = to[-1] == 0xA5 && to[len] == 0x5A;
+                    for (u32 i = 0; ok && i < len; i++)
+                        ok = to[i] == (set ? u8(repeat - 1) : from[i]);
+
+                    if (!ok) {
+                        Report("%s: wrong result, dst +%u src +%u length %u",
+                               name, dstOffset, srcOffset, len);
+                        return;
+                    }
+                }
+            }
+        }
+
+        for (u32 type = 0; type < 2; type++) {
+            totalUsec[type] = std::max<u64>(totalUsec[type], 1);
+            // Bytes per microsecond is MB/s
+            const u32 rate = bytes[type] * 100 / totalUsec[type];
+
+            Report("%s %5u B %-9s %6u KiB %4u.%02u MB/s", name, size,
+                   type == 0 ? "aligned" : "unaligned",
+                   u32(bytes[type] / 1024), rate / 100, rate % 100);
+        }
+    }
+}
+
+static void RunDevice(u32 devId)
+{
+    const FATFS* fs = DeviceMgr::sInstance->GetFilesystem(devId);
+
+    // Stay inside the data area of the volume
+    const u32 base = fs->database;
+    const u32 span = std::min<u32>((fs->n_fatent - 2) * fs->csize,
+                                   MaxSpanSectors);
+    if (span < SeqTotalSize / SectorSize) {
+        Report("Volume on device %u is too small", devId);
+        return;
+    }
+
+    static const u32 seqSizes[] = {
+        512, 4 * 1024, 32 * 1024, 128 * 1024, 1024 * 1024,
+    };
+
+    for (u32 i = 0; i < std::size(seqSizes); i++) {
+        const u32 size = seqSizes[i];
+        if (size > s_bufferSize) {
+            Report("Skipping sequential %u KiB, buffer is %u KiB", size / 1024,
+                   s_bufferSize / 1024);
+            continue;
+        }
+
+        // Start each size somewhere new so it doesn't hit the card's cache
+        const u32 start = base + (i * SeqTotalSize / SectorSize) % span;
+        const u32 count = size / SectorSize;
+
+        char name[24];
+        snprintf(name, sizeof(name), "seq %u%s",
+                 size < 1024 ? size : size / 1024, size < 1024 ? " B" : " KiB");
+        RunWorkload(name, devId, SeqTotalSize / size, [&](u32 op) {
+            return Op{start + op * count, count};
+        });
+    }
+
+    const u32 pageCount = span / 8;
+    RunWorkload("random 4 KiB", devId, 512, [&](u32 op) {
+        return Op{base + (Random() % pageCount) * 8, 8};
+    });
+
+    /*
+     * Roughly what FatFS does loading the DOLs from the blob: mostly cluster
+     * sized sequential reads, with a FAT sector every few clusters and the odd
+     * small read elsewhere for directory lookups.
+     */
+    u32 dataSector = base + span / 2;
+    RunWorkload("boot mix", devId, 512, [&](u32 op) {
+        if (op % 8 == 0)
+            return Op{fs->fatbase + (op / 8) % fs->fsize, 1};
+
+        if (op % 16 == 7)
+            return Op{base + (Random() % pageCount) * 8, 8};
+
+        const Op ret = {dataSector, 64};
+        dataSector = base + (dataSector - base + 64) % (span - 64);
+        return ret;
+    });
+}
+
+static void RunBlob(u32 blobDevId, u32 blobSectors)
+{
+    const u32 blockCount = blobSectors / BlobBlockSectors;
+    if (blockCount < 2) {
+        Report("Blob is too small");
+        return;
+    }
+
+    RunWorkload("blob aligned", blobDevId, 512, [&](u32 op) {
+        return Op{(Random() % blockCount) * BlobBlockSectors, 8};
+    });
+
+    // The IV has to be read from the previous sector, unless the last read
+    // ended right before this one
+    RunWorkload("blob mid-block", blobDevId, 512, [&](u32 op) {
+        const u32 offset = 1 + Random() % (BlobBlockSectors - 8 - 1);
+        return Op{(Random() % blockCount) * BlobBlockSectors + offset, 8};
+    });
+}
+
+void Run(u32 devId, u32 blobDevId, u32 blobSectors)
+{
+    for (s_bufferSize = MaxBufferSize; s_bufferSize >= MinBufferSize;
+         s_bufferSize /= 2) {
+        s_buffer = reinterpret_cast<u8*>(
+            IOS_AllocAligned(IOS::ipcHeap, s_bufferSize, 64));
+        if (s_buffer != nullptr)
+            break;
+    }
+
+    if (s_buffer == nullptr)
+        return;
+
+#ifndef TARGET_HOST
+    if (!DeviceMgr::sInstance->IsLogEnabled()) {
+        char path[16] = "0:log.txt";
+        path[0] = devId + '0';
+        s_logOpened =
+            f_open(&s_logFile, path, FA_OPEN_APPEND | FA_WRITE) == FR_OK;
+    }
+#endif
+
+    Report("Memory benchmark");
+    RunMemory(false);
+    RunMemory(true);
+
+    Report("Storage benchmark on device %u", devId);
+    RunDevice(devId);
+    RunBlob(blobDevId, blobSectors);
+    Report("Storage benchmark done");
+
+#ifndef TARGET_HOST
+    if (s_logOpened) {
+        f_close(&s_logFile);
+        s_logOpened = false;
+    }
+#endif
+
+    IOS_Free(IOS::ipcHeap, s_buffer);
+    s_buffer = nullptr;
+}
+
+} // namespace StorageBench
+
+#endif
@@ -0,0 +1,22 @@
+// StorageBench.hpp - Sector-level storage benchmark
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <System/Types.h>
+
+/*
+ * Fixed read workloads over DeviceMgr::DeviceRead, run once after the blob is
+ * mounted if Config::IsStorageBenchEnabled. Every workload uses the same seed,
+ * so two runs against the same disk issue the same reads. memcpy and memset
+ * are timed first, with unaligned heads and tails. Only built with
+ * STORAGE_BENCH defined: make STORAGE_BENCH=1 builds it in and enables it,
+ * the host build always has it and enables it with -b.
+ */
+namespace StorageBench
+{
+
+void Run(u32 devId, u32 blobDevId, u32 blobSectors);
+
+} // namespace StorageBench
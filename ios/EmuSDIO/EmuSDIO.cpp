@@ -4,6 +4,7 @@
 // SPDX-License-Identifier: MIT
 
 #include "EmuSDIO.hpp"
+#include "SDIOTrace.hpp"
 #include <Debug/Log.hpp>
 #include <Disk/DeviceMgr.hpp>
 #include <IOS/IPCLog.hpp>
@@ -65,7 +66,7 @@ struct SDIORequest {
     u32 arg;
     u32 blkCnt;
     u32 blkSize;
-    void* addr;
+    u32 addr;
     u32 isDMA;
     u32 pad0;
 };
@@ -194,7 +195,7 @@ static s32 ExecuteCommand(SDIORequest req, void* rwBuffer, u32 rwBufferLen,
             return RET_FAIL;
         }
 
-        if (((void*)(u32(req.addr) & 0x7FFFFFFF) != rwBuffer) ||
+        if (((void*)uintptr_t(req.addr & 0x7FFFFFFF) != rwBuffer) ||
             (req.blkCnt * 512 != rwBufferLen)) {
             PRINT(IOS_EmuSDIO, ERROR, "Invalid RW buffer supplied");
             PRINT(IOS_EmuSDIO, ERROR, "req.addr = %08X, rwBuffer = %08X",
@@ -205,8 +206,12 @@ static s32 ExecuteCommand(SDIORequest req, void* rwBuffer, u32 rwBufferLen,
             return RET_FAIL;
         }
 
-        if (!DeviceMgr::sInstance->DeviceRead(EmuSDIO::g_emuDevId, rwBuffer,
-                                              req.arg, req.blkCnt)) {
+        const u32 traceStart = SDIOTrace::Begin();
+        const bool ok = DeviceMgr::sInstance->DeviceRead(
+            EmuSDIO::g_emuDevId, rwBuffer, req.arg, req.blkCnt);
+        SDIOTrace::End(u32(req.cmd), req.arg, req.blkCnt, ok, traceStart);
+
+        if (!ok) {
             return RET_FAIL;
         }
 
@@ -222,14 +227,18 @@ static s32 ExecuteCommand(SDIORequest req, void* rwBuffer, u32 rwBufferLen,
             return RET_FAIL;
         }
 
-        if ((void*)(u32(req.addr) & 0x7FFFFFFF) != rwBuffer ||
+        if ((void*)uintptr_t(req.addr & 0x7FFFFFFF) != rwBuffer ||
             req.blkCnt * 512 != rwBufferLen) {
             PRINT(IOS_EmuSDIO, ERROR, "Invalid RW buffer supplied");
             return RET_FAIL;
         }
 
-        if (!DeviceMgr::sInstance->DeviceWrite(EmuSDIO::g_emuDevId, rwBuffer,
-                                               req.arg, req.blkCnt)) {
+        const u32 traceStart = SDIOTrace::Begin();
+        const bool ok = DeviceMgr::sInstance->DeviceWrite(
+            EmuSDIO::g_emuDevId, rwBuffer, req.arg, req.blkCnt);
+        SDIOTrace::End(u32(req.cmd), req.arg, req.blkCnt, ok, traceStart);
+
+        if (!ok) {
             return RET_FAIL;
         }
 
@@ -366,6 +375,8 @@ s32 EmuSDIO::ThreadEntry([[maybe_unused]] void* arg)
     }
 
     PRINT(IOS_EmuSDIO, INFO, "Device inserted, starting emulation...");
+    // Before any requests are handled, while the PPC has nothing mounted
+    SDIOTrace::Open(EmuSDIO::g_emuDevId);
     IPCLog::sInstance->Notify(3);
     while (true) {
         IOS::Request* req = queue.receive();
@@ -0,0 +1,139 @@
+// SDIOTrace.cpp - EmuSDIO access trace
+//
+// SPDX-License-Identifier: MIT
+
+#ifdef SDIO_TRACE
+
+#include "SDIOTrace.hpp"
+#include <Debug/Log.hpp>
+#include <Disk/DeviceMgr.hpp>
+#include <FAT/ff.h>
+#include <IOS/Syscalls.h>
+#include <System/Util.h>
+#include <cstring>
+
+namespace SDIOTrace
+{
+
+constexpr u32 SectorSize = 512;
+constexpr u32 RecordsPerSector = SectorSize / sizeof(Record);
+
+static bool s_opened;
+static u32 s_devId;
+static u32 s_headerSector;
+static u32 s_sectorCount;
+
+static u32 s_lastTick;
+static u32 s_elapsedUsec;
+
+static u32 s_recordCount;
+static Header s_header[SectorSize / sizeof(Header)] ATTRIBUTE_ALIGN(32);
+static Record s_records[RecordsPerSector] ATTRIBUTE_ALIGN(32);
+
+static u32 TicksToUsec(u32 ticks)
+{
+    return u64(ticks) * 128 / 243;
+}
+
+/*
+ * Write a sector of records and then the header. Both go straight to the
+ * device, the file's clusters were allocated by Open.
+ */
+static bool Flush(u32 recordSector)
+{
+    const u32 sector = s_headerSector + 1 + recordSector;
+    if (!DeviceMgr::sInstance->DeviceWrite(s_devId, s_records, sector, 1))
+        return false;
+
+    s_header[0].recordCount = s_recordCount;
+    return DeviceMgr::sInstance->DeviceWrite(s_devId, s_header,
+                                             s_headerSector, 1);
+}
+
+void Open(u32 devId)
+{
+    char path[32] = "0:sdio_trace.bin";
+    path[0] = devId + '0';
+
+    FIL file;
+    FRESULT fret = f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE);
+    if (fret != FR_OK) {
+        PRINT(IOS_EmuSDIO, ERROR, "Failed to create '%s': %d", path, fret);
+        return;
+    }
+
+    // Contiguous, so the records can be written by sector
+    fret = f_expand(&file, FileSize, 1);
+    const FATFS* fs = file.obj.fs;
+    const u32 cluster = file.obj.sclust;
+    f_close(&file);
+
+    if (fret != FR_OK) {
+        PRINT(IOS_EmuSDIO, ERROR, "Failed to allocate '%s': %d", path, fret);
+        return;
+    }
+
+    s_devId = devId;
+    s_headerSector = fs->database + (cluster - 2) * fs->csize;
+    s_sectorCount = FileSize / SectorSize;
+
+    s_header[0] = {
+        .magic = Magic,
+        .version = Version,
+        .recordSize = sizeof(Record),
+        .recordCount = 0,
+    };
+    s_recordCount = 0;
+    memset(s_records, 0, sizeof(s_records));
+
+    if (!Flush(0)) {
+        PRINT(IOS_EmuSDIO, ERROR, "Failed to write '%s'", path);
+        return;
+    }
+
+    s_lastTick = IOS_GetTime();
+    s_elapsedUsec = 0;
+    s_opened = true;
+    PRINT(IOS_EmuSDIO, INFO, "Recording SDIO trace to '%s'", path);
+}
+
+u32 Begin()
+{
+    return IOS_GetTime();
+}
+
+void End(u32 cmd, u32 sector, u32 count, bool ok, u32 start)
+{
+    if (!s_opened)
+        return;
+
+    const u32 now = IOS_GetTime();
+    // Accumulated so the timer wrapping doesn't matter
+    s_elapsedUsec += TicksToUsec(start - s_lastTick);
+    s_lastTick = start;
+
+    Record& record = s_records[s_recordCount % RecordsPerSector];
+    record.time = s_elapsedUsec;
+    record.sector = sector;
+    record.cmdCount = (cmd << 24) | (count & 0xFFFFFF);
+    record.duration = TicksToUsec(now - start) | (ok ? 0 : DurationFailed);
+    s_recordCount++;
+
+    if (s_recordCount % RecordsPerSector != 0)
+        return;
+
+    const u32 recordSector = s_recordCount / RecordsPerSector - 1;
+    const bool flushed = Flush(recordSector);
+    memset(s_records, 0, sizeof(s_records));
+
+    // The next sector of records would be past the end of the file
+    if (!flushed || 1 + recordSector + 1 >= s_sectorCount) {
+        PRINT(IOS_EmuSDIO, WARN, "Stopped SDIO trace at %u records",
+              s_recordCount);
+        s_opened = false;
+    }
+}
+
+} // namespace SDIOTrace
+
+#endif
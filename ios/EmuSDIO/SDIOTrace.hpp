@@ -0,0 +1,72 @@
+// SDIOTrace.hpp - EmuSDIO access trace
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <System/Types.h>
+
+/*
+ * Records every multi-block read and write the PPC sends to EmuSDIO, for
+ * replaying with the host build's -r option. Only recorded with SDIO_TRACE
+ * defined (make SDIO_TRACE=1), otherwise the hooks compile to nothing.
+ *
+ * The trace is sdio_trace.bin on the emulated device. It's allocated
+ * contiguously up front and then written as raw sectors, so recording never
+ * changes the file system the PPC has mounted. The first sector holds the
+ * header and the records follow. Everything is big endian. The header is
+ * rewritten each time a sector of records is, so up to a sector of records
+ * may be lost at the end.
+ */
+namespace SDIOTrace
+{
+
+constexpr u32 Magic = 0x53445452; // SDTR
+constexpr u32 Version = 1;
+constexpr u32 FileSize = 4 * 1024 * 1024;
+
+struct Header {
+    u32 magic;
+    u32 version;
+    u32 recordSize;
+    u32 recordCount;
+};
+
+struct Record {
+    // Microseconds since the trace was opened
+    u32 time;
+    u32 sector;
+    // SDIO command in the top 8 bits, sector count in the rest
+    u32 cmdCount;
+    // Microseconds spent in DeviceMgr, top bit set if it failed
+    u32 duration;
+};
+
+static_assert(sizeof(Record) == 16);
+
+constexpr u32 DurationFailed = 0x80000000;
+
+#ifdef SDIO_TRACE
+
+void Open(u32 devId);
+u32 Begin();
+void End(u32 cmd, u32 sector, u32 count, bool ok, u32 start);
+
+#else
+
+static inline void Open(u32 devId)
+{
+}
+
+static inline u32 Begin()
+{
+    return 0;
+}
+
+static inline void End(u32 cmd, u32 sector, u32 count, bool ok, u32 start)
+{
+}
+
+#endif
+
+} // namespace SDIOTrace
@@ -3327,6 +3327,144 @@ static UINT find_volume (   /* Returns BS status found in the hosting drive */
 
 
 
+#if FF_LOOKUP_CACHE
+/*-----------------------------------------------------------------------*/
+/* Lookup cache of files opened read-only                                */
+/*-----------------------------------------------------------------------*/
+
+static void lcache_flush (
+    FATFS* fs           /* Filesystem object */
+)
+{
+    UINT i;
+
+
+    for (i = 0; i < FF_LOOKUP_CACHE; i++) fs->lcache[i].path[0] = 0;
+    fs->lcache_next = 0;
+}
+
+
+static LCENT* lcache_find (
+    FATFS* fs,          /* Filesystem object */
+    const TCHAR* path   /* Path without the volume ID */
+)
+{
+    UINT i;
+
+
+    if (!IsSeparator(*path)) return 0;  /* Relative paths depend on the current directory */
+    for (i = 0; i < FF_LOOKUP_CACHE; i++) {
+        if (fs->lcache[i].path[0] && !strcmp(fs->lcache[i].path, path)) return &fs->lcache[i];
+    }
+    return 0;
+}
+
+
+static int lcache_open (   /* 1:Opened from the cache, 0:Not cached */
+    FATFS* fs,          /* Filesystem object */
+    const TCHAR* path,  /* Path without the volume ID */
+    FIL* fp             /* File object to open */
+)
+{
+    LCENT* ent = lcache_find(fs, path);
+
+
+    if (!ent) return 0;
+#if FF_FS_EXFAT
+    if (fs->fs_type == FS_EXFAT) {
+        fp->obj.c_scl = (DWORD)ent->dsect;
+        fp->obj.c_size = ent->c_size;
+        fp->obj.c_ofs = ent->dofs;
+        fp->obj.stat = ent->stat;
+        fp->obj.n_frag = 0;
+    } else
+#endif
+    {
+        fp->dir_sect = ent->dsect;
+        fp->dir_ptr = fs->win + ent->dofs;
+    }
+    fp->obj.sclust = ent->sclust;
+    fp->obj.objsize = ent->objsize;
+    fp->mtime = ent->mtime;
+#if FF_USE_FASTSEEK
+    fp->cltbl = 0;
+#endif
+    fp->obj.fs = fs;
+    fp->obj.id = fs->id;
+    fp->flag = FA_READ;
+    fp->err = 0;
+    fp->sect = 0;
+    fp->fptr = 0;
+#if !FF_FS_TINY
+    memset(fp->buf, 0, sizeof fp->buf);
+#endif
+    return 1;
+}
+
+
+static void lcache_put (
+    FATFS* fs,          /* Filesystem object */
+    const TCHAR* path,  /* Path without the volume ID */
+    const FIL* fp       /* File object that was just opened */
+)
+{
+    LCENT* ent;
+
+
+    if (!IsSeparator(*path) || strlen(path) >= FF_LOOKUP_PATH) return;
+    ent = lcache_find(fs, path);
+    if (!ent) {
+        ent = &fs->lcache[fs->lcache_next];
+        fs->lcache_next = (BYTE)((fs->lcache_next + 1) % FF_LOOKUP_CACHE);
+    }
+    strcpy(ent->path, path);
+#if FF_FS_EXFAT
+    if (fs->fs_type == FS_EXFAT) {
+        ent->dsect = fp->obj.c_scl;
+        ent->dofs = fp->obj.c_ofs;
+        ent->c_size = fp->obj.c_size;
+        ent->stat = fp->obj.stat;
+    } else
+#endif
+    {
+        ent->dsect = fp->dir_sect;
+        ent->dofs = (DWORD)(fp->dir_ptr - fs->win);
+    }
+    ent->sclust = fp->obj.sclust;
+    ent->objsize = fp->obj.objsize;
+    ent->mtime = fp->mtime;
+}
+
+
+static void lcache_drop (  /* Forget the entry of a file that is being modified */
+    FATFS* fs,          /* Filesystem object */
+    const FIL* fp       /* Modified file */
+)
+{
+    UINT i;
+    LBA_t dsect;
+    DWORD dofs;
+
+
+#if FF_FS_EXFAT
+    if (fs->fs_type == FS_EXFAT) {
+        dsect = fp->obj.c_scl;
+        dofs = fp->obj.c_ofs;
+    } else
+#endif
+    {
+        dsect = fp->dir_sect;
+        dofs = (DWORD)(fp->dir_ptr - fs->win);
+    }
+    for (i = 0; i < FF_LOOKUP_CACHE; i++) {
+        if (fs->lcache[i].dsect == dsect && fs->lcache[i].dofs == dofs) fs->lcache[i].path[0] = 0;
+    }
+}
+
+#endif
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Determine logical drive number and mount the volume if needed         */
 /*-----------------------------------------------------------------------*/
@@ -3538,6 +3676,9 @@ static FRESULT mount_volume (   /* FR_OK(0): successful, !=0: an error occurred
 
     fs->fs_type = (BYTE)fmt;/* FAT sub-type */
     fs->id = ++Fsid;        /* Volume mount ID */
+#if FF_LOOKUP_CACHE
+    lcache_flush(fs);       /* The media may have been changed since the last mount */
+#endif
 #if FF_USE_LFN == 1
     fs->lfnbuf = LfnBuf;    /* Static LFN working buffer */
 #if FF_FS_EXFAT
@@ -3629,10 +3770,16 @@ FRESULT f_mount (
         if (!ff_del_syncobj(cfs->sobj)) return FR_INT_ERR;
 #endif
         cfs->fs_type = 0;               /* Clear old fs object */
+#if FF_LOOKUP_CACHE
+        lcache_flush(cfs);              /* The media may be changed while unmounted */
+#endif
     }
 
     if (fs) {
         fs->fs_type = 0;                /* Clear new fs object */
+#if FF_LOOKUP_CACHE
+        lcache_flush(fs);               /* Lookups of a previous volume are not valid */
+#endif
 #if FF_FS_REENTRANT                     /* Create sync object for the new volume */
         if (!ff_cre_syncobj((BYTE)vol, &fs->sobj)) return FR_INT_ERR;
 #endif
@@ -3675,11 +3822,13 @@ FRESULT f_fastopen (
             fp->obj.objsize = ld_qword(dir + XDIR_FileSize);    /* Size */
             fp->obj.stat = dir[XDIR_GenFlags] & 2;              /* Allocation status */
             fp->obj.n_frag = 0;                                 /* No last fragment info */
+            fp->mtime = 0;                                      /* Only in the file entry, not the stream extension */
         } else
 #endif
         {
             fp->obj.sclust = ld_clust(fs, dir);                 /* Get object allocation info */
             fp->obj.objsize = ld_dword(dir + DIR_FileSize);
+            fp->mtime = ld_dword(dir + DIR_ModTime);            /* Modified time */
         }
 #if FF_USE_FASTSEEK
             fp->cltbl = 0;                                      /* Disable fast seek mode */
@@ -3731,6 +3880,11 @@ FRESULT f_open (
     /* Get logical drive number */
     mode &= FF_FS_READONLY ? FA_READ : FA_READ | FA_WRITE | FA_CREATE_ALWAYS | FA_CREATE_NEW | FA_OPEN_ALWAYS | FA_OPEN_APPEND;
     res = mount_volume(&path, &fs, mode);
+#if FF_LOOKUP_CACHE
+    if (res == FR_OK) {
+        if (mode == FA_READ && lcache_open(fs, path, fp)) LEAVE_FF(fs, FR_OK);  /* Skip the directory scan */
+    }
+#endif
     if (res == FR_OK) {
         dj.obj.fs = fs;
         INIT_NAMBUF(fs);
@@ -3844,11 +3998,13 @@ FRESULT f_open (
                 fp->obj.c_size = ((DWORD)dj.obj.objsize & 0xFFFFFF00) | dj.obj.stat;
                 fp->obj.c_ofs = dj.blk_ofs;
                 init_alloc_info(fs, &fp->obj);
+                fp->mtime = ld_dword(fs->dirbuf + XDIR_ModTime);        /* Modified time */
             } else
 #endif
             {
                 fp->obj.sclust = ld_clust(fs, dj.dir);                  /* Get object allocation info */
                 fp->obj.objsize = ld_dword(dj.dir + DIR_FileSize);
+                fp->mtime = ld_dword(dj.dir + DIR_ModTime);             /* Modified time */
             }
 #if FF_USE_FASTSEEK
             fp->cltbl = 0;      /* Disable fast seek mode */
@@ -3890,6 +4046,14 @@ FRESULT f_open (
             }
 #endif
         }
+#if FF_LOOKUP_CACHE
+        if (res == FR_OK) {
+            if (mode == FA_READ) lcache_put(fs, path, fp);
+            if (mode & FA_CREATE_ALWAYS) lcache_drop(fs, fp);   /* The entry was created or truncated */
+        } else if (mode & FA_CREATE_ALWAYS) {
+            lcache_flush(fs);   /* A failed create may have left the entry half truncated */
+        }
+#endif
 
         FREE_NAMBUF();
     }
@@ -4140,6 +4304,9 @@ FRESULT f_sync (
     res = validate(&fp->obj, &fs);  /* Check validity of the file object */
     if (res == FR_OK) {
         if (fp->flag & FA_MODIFIED) {   /* Is there any change to the file? */
+#if FF_LOOKUP_CACHE
+            lcache_drop(fs, fp);
+#endif
 #if !FF_FS_TINY
             if (fp->flag & FA_DIRTY) {  /* Write-back cached data if needed */
                 if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) LEAVE_FF(fs, FR_DISK_ERR);
@@ -4173,6 +4340,7 @@ FRESULT f_sync (
                         if (res == FR_OK) {
                             res = sync_fs(fs);
                             fp->flag &= (BYTE)~FA_MODIFIED;
+                            fp->mtime = tm;
                         }
                     }
                     FREE_NAMBUF();
@@ -4191,6 +4359,7 @@ FRESULT f_sync (
                     fs->wflag = 1;
                     res = sync_fs(fs);                  /* Restore it to the directory */
                     fp->flag &= (BYTE)~FA_MODIFIED;
+                    fp->mtime = tm;
                 }
             }
         }
@@ -5020,6 +5189,9 @@ FRESULT f_unlink (
 
     /* Get logical drive */
     res = mount_volume(&path, &fs, FA_WRITE);
+#if FF_LOOKUP_CACHE
+    if (res == FR_OK) lcache_flush(fs);    /* The directory tree changes */
+#endif
     if (res == FR_OK) {
         dj.obj.fs = fs;
         INIT_NAMBUF(fs);
@@ -5111,6 +5283,9 @@ FRESULT f_mkdir (
 
 
     res = mount_volume(&path, &fs, FA_WRITE);   /* Get logical drive */
+#if FF_LOOKUP_CACHE
+    if (res == FR_OK) lcache_flush(fs);    /* The directory tree changes */
+#endif
     if (res == FR_OK) {
         dj.obj.fs = fs;
         INIT_NAMBUF(fs);
@@ -5197,6 +5372,9 @@ FRESULT f_rename (
 
     get_ldnumber(&path_new);                        /* Snip the drive number of new name off */
     res = mount_volume(&path_old, &fs, FA_WRITE);   /* Get logical drive of the old object */
+#if FF_LOOKUP_CACHE
+    if (res == FR_OK) lcache_flush(fs);    /* The directory tree changes */
+#endif
     if (res == FR_OK) {
         djo.obj.fs = fs;
         INIT_NAMBUF(fs);
@@ -5305,6 +5483,9 @@ FRESULT f_chmod (
 
 
     res = mount_volume(&path, &fs, FA_WRITE);   /* Get logical drive */
+#if FF_LOOKUP_CACHE
+    if (res == FR_OK) lcache_flush(fs);    /* The directory tree changes */
+#endif
     if (res == FR_OK) {
         dj.obj.fs = fs;
         INIT_NAMBUF(fs);
@@ -5351,6 +5532,9 @@ FRESULT f_utime (
 
 
     res = mount_volume(&path, &fs, FA_WRITE);   /* Get logical drive */
+#if FF_LOOKUP_CACHE
+    if (res == FR_OK) lcache_flush(fs);    /* The directory tree changes */
+#endif
     if (res == FR_OK) {
         dj.obj.fs = fs;
         INIT_NAMBUF(fs);
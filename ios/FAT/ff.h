@@ -127,6 +127,23 @@ extern const char* VolumeStr[FF_VOLUMES];   /* User defied volume ID */
 
 
 
+#if FF_LOOKUP_CACHE
+/* Lookup cache entry (LCENT) */
+
+typedef struct {
+    TCHAR   path[FF_LOOKUP_PATH];   /* Absolute path without the volume ID (empty:unused) */
+    LBA_t   dsect;          /* Sector of the directory entry (exFAT: containing directory start cluster) */
+    DWORD   dofs;           /* Offset of the entry in dsect (exFAT: offset in the containing directory) */
+    DWORD   c_size;         /* exFAT: Size of containing directory and chain status */
+    DWORD   sclust;         /* Object start cluster */
+    FSIZE_t objsize;        /* Object size */
+    BYTE    stat;           /* exFAT: Object chain status */
+    DWORD   mtime;          /* Modified time and date of the object */
+} LCENT;
+#endif
+
+
+
 /* Filesystem object structure (FATFS) */
 
 typedef struct {
@@ -173,6 +190,10 @@ typedef struct {
 #endif
     LBA_t   winsect;        /* Current sector appearing in the win[] */
     BYTE    win[FF_MAX_SS]; /* Disk access window for Directory, FAT (and file data at tiny cfg) */
+#if FF_LOOKUP_CACHE
+    LCENT   lcache[FF_LOOKUP_CACHE];    /* Lookup cache of files opened read-only */
+    BYTE    lcache_next;    /* Next lookup cache entry to replace */
+#endif
 } FATFS;
 
 
@@ -216,6 +237,7 @@ typedef struct {
 #if FF_USE_FASTSEEK
     DWORD*  cltbl;          /* Pointer to the cluster link map table (nulled on open, set by application) */
 #endif
+    DWORD   mtime;          /* Modified time and date of the directory entry (Saoirse extension) */
 #if !FF_FS_TINY
     BYTE    buf[FF_MAX_SS]; /* File private data read/write window */
 #endif
@@ -38,7 +38,7 @@
 /* This option switches fast seek function. (0:Disable or 1:Enable) */
 
 
-#define FF_USE_EXPAND	0
+#define FF_USE_EXPAND	1
 /* This option switches f_expand function. (0:Disable or 1:Enable) */
 
 
@@ -237,6 +237,15 @@
 /  Note that enabling exFAT discards ANSI C (C89) compatibility. */
 
 
+#define FF_LOOKUP_CACHE	4
+#define FF_LOOKUP_PATH	32
+/* Saoirse extension. FF_LOOKUP_CACHE sets the number of files opened with only
+/  FA_READ whose directory entry is remembered per volume, so opening the same
+/  absolute path again skips the directory scan. FF_LOOKUP_PATH is the longest
+/  cached path including the terminator. The cache is cleared on mount, on
+/  unmount and on any change to the directory tree. (0:Disable) */
+
+
 #define FF_FS_NORTC		0
 #define FF_NORTC_MON	1
 #define FF_NORTC_MDAY	1
@@ -5,6 +5,7 @@
 
 #include "EmuES.hpp"
 #include <CTGP/EmuHID.hpp>
+#include <Debug/BootTimeline.h>
 #include <Debug/Log.hpp>
 #include <IOS/IPCLog.hpp>
 #include <IOS/Patch.hpp>
@@ -13,7 +14,10 @@
 #include <System/Config.hpp>
 #include <System/ES.hpp>
 #include <System/Hollywood.hpp>
+#include <System/MemStats.hpp>
 #include <System/OS.hpp>
+#include <System/Profiler.hpp>
+#include <System/Slab.hpp>
 #include <System/Util.h>
 #include <algorithm>
 #include <cstdio>
@@ -113,6 +117,198 @@ static void CloseAllPPC(bool ack)
     }
 }
 
+/*
+ * The replacement stub is encrypted on a worker thread as soon as the title
+ * key and content index are known, so AddContentFinish only has to stream
+ * ciphertext to ES. Chunks are passed through a small ring of slots in the IPC
+ * heap, so encryption can run a few chunks ahead of the writes. If the heap is
+ * too fragmented for that, two slots still let the next chunk be encrypted
+ * while the last one is being written. If even that fails, the stub is
+ * encrypted a page at a time in AddContentFinish, as before.
+ */
+static constexpr u32 StubChunkSize = 0x10000; // /dev/aes maximum input size
+static constexpr u32 StubMaxSlots = 4;
+
+static Queue<u32> s_stubStartQueue(1);
+// Slot index of each encrypted chunk, or a negative AES error
+static Queue<s32> s_stubReadyQueue(StubMaxSlots);
+static Queue<u32> s_stubFreeQueue(StubMaxSlots);
+
+static u8 s_stubKey[16] ATTRIBUTE_ALIGN(32);
+static u8 s_stubIv[16] ATTRIBUTE_ALIGN(32);
+static u8* s_stubRing = nullptr;
+static u32 s_stubChunkCount = 0;
+// Chunks not yet taken from the ready queue, zero if no job is running
+static u32 s_stubChunksLeft = 0;
+// No ring, so StubCryptWrite has to encrypt as it goes
+static bool s_stubSyncPending = false;
+
+static s32 StubCryptThreadEntry([[maybe_unused]] void* arg)
+{
+    while (true) {
+        s_stubStartQueue.receive();
+
+        const u8* input = reinterpret_cast<const u8*>(System::s_dolData);
+        for (u32 i = 0; i < s_stubChunkCount; i++) {
+            const u32 slot = s_stubFreeQueue.receive();
+            const u32 pos = i * StubChunkSize;
+            const u32 size = std::min(System::s_dolSize - pos, StubChunkSize);
+
+            const s32 ret =
+                AES::sInstance->Encrypt(s_stubKey, s_stubIv, input + pos, size,
+                                        s_stubRing + slot * StubChunkSize);
+            if (ret != IOSError::OK) {
+                s_stubReadyQueue.send(ret < 0 ? ret : IOSError::Invalid);
+                break;
+            }
+
+            s_stubReadyQueue.send(slot);
+        }
+    }
+}
+
+/*
+ * Take the remaining chunks of the current job, if any, and release its ring.
+ * The worker is idle afterwards.
+ */
+static void StubCryptDrain()
+{
+    while (s_stubChunksLeft != 0) {
+        const s32 slot = s_stubReadyQueue.receive();
+        if (slot < 0)
+            break;
+
+        s_stubFreeQueue.send(slot);
+        s_stubChunksLeft--;
+    }
+    s_stubChunksLeft = 0;
+
+    if (s_stubRing != nullptr) {
+        s32 ret = IOS_Free(IOS::ipcHeap, s_stubRing);
+        ASSERT(ret == IOSError::OK);
+        s_stubRing = nullptr;
+    }
+}
+
+static void StubCryptStart()
+{
+    StubCryptDrain();
+    s_stubSyncPending = false;
+
+    memcpy(s_stubKey, s_ctgpTitleKey, 16);
+    memset(s_stubIv, 0, 16);
+    s_stubIv[0] = (s_ctgpStubIndex >> 8) & 0xFF;
+    s_stubIv[1] = s_ctgpStubIndex & 0xFF;
+
+    const u32 chunkCount =
+        round_up(System::s_dolSize, StubChunkSize) / StubChunkSize;
+    u32 slotCount = std::min(chunkCount, StubMaxSlots);
+
+    // Not IOS::Alloc, which asserts instead of letting this fall back
+    s_stubRing = reinterpret_cast<u8*>(
+        IOS_AllocAligned(IOS::ipcHeap, slotCount * StubChunkSize, 32));
+    if (s_stubRing == nullptr && slotCount > 2) {
+        slotCount = 2;
+        s_stubRing = reinterpret_cast<u8*>(
+            IOS_AllocAligned(IOS::ipcHeap, slotCount * StubChunkSize, 32));
+    }
+
+    if (s_stubRing == nullptr) {
+        PRINT(IOS_EmuES, WARN,
+              "No memory for the stub encryption ring, encrypting on write");
+        s_stubSyncPending = true;
+        return;
+    }
+
+    // Reset the free slots left over from the last job
+    u32 msg;
+    while (IOS_ReceiveMessage(s_stubFreeQueue.id(), &msg, 1) == IOS_SUCCESS) {
+    }
+    for (u32 i = 0; i < slotCount; i++)
+        s_stubFreeQueue.send(i);
+
+    s_stubChunkCount = chunkCount;
+    s_stubChunksLeft = chunkCount;
+    s_stubStartQueue.send(0);
+
+    PRINT(IOS_EmuES, INFO, "Encrypting stub in the background, %u slots",
+          slotCount);
+}
+
+/*
+ * Encrypt and write the stub a page at a time, without the worker.
+ */
+static ES::ESError StubCryptWriteSync(s32 cfd)
+{
+    static constexpr u32 WriteSize = 0x1000;
+    u8* cryptData = new u8[WriteSize];
+
+    for (u32 pos = 0; pos < System::s_dolSize; pos += WriteSize) {
+        u32 size = std::min(System::s_dolSize - pos, WriteSize);
+
+        auto aesRet = AES::sInstance->Encrypt(
+            s_stubKey, s_stubIv, System::s_dolData + pos, size, cryptData);
+        if (aesRet != 0) {
+            PRINT(IOS_EmuES, ERROR, "AES encryption failed: %d", aesRet);
+            delete[] cryptData;
+            return ES::ESError::Invalid;
+        }
+
+        auto esRet = ES::sInstance->AddContentData(cfd, cryptData, size);
+        if (esRet != ES::ESError::OK) {
+            PRINT(IOS_EmuES, ERROR, "ES AddContentData failed: %d", esRet);
+            delete[] cryptData;
+            return esRet;
+        }
+    }
+
+    delete[] cryptData;
+    return ES::ESError::OK;
+}
+
+/*
+ * Write the encrypted stub to the content file as chunks become ready.
+ */
+static ES::ESError StubCryptWrite(s32 cfd)
+{
+    if (s_stubSyncPending) {
+        s_stubSyncPending = false;
+        return StubCryptWriteSync(cfd);
+    }
+
+    if (s_stubChunksLeft == 0) {
+        PRINT(IOS_EmuES, ERROR, "Stub encryption was not started");
+        return ES::ESError::Invalid;
+    }
+
+    for (u32 i = 0; s_stubChunksLeft != 0; i++) {
+        const s32 slot = s_stubReadyQueue.receive();
+        if (slot < 0) {
+            PRINT(IOS_EmuES, ERROR, "AES encryption failed: %d", slot);
+            s_stubChunksLeft = 0;
+            StubCryptDrain();
+            return ES::ESError::Invalid;
+        }
+
+        const u32 pos = i * StubChunkSize;
+        const u32 size = std::min(System::s_dolSize - pos, StubChunkSize);
+        auto ret = ES::sInstance->AddContentData(
+            cfd, s_stubRing + slot * StubChunkSize, size);
+
+        s_stubFreeQueue.send(slot);
+        s_stubChunksLeft--;
+
+        if (ret != ES::ESError::OK) {
+            PRINT(IOS_EmuES, ERROR, "ES AddContentData failed: %d", ret);
+            StubCryptDrain();
+            return ret;
+        }
+    }
+
+    StubCryptDrain();
+    return ES::ESError::OK;
+}
+
 /*
  * Handles ES ioctlv commands.
  */
@@ -247,7 +443,8 @@ static ES::ESError ReqIoctlv(ES::ESIoctl cmd, u32 inCount, u32 outCount,
 
         u32 tmdSize = tmd->size();
 
-        u8* tmdBlob = new u8[tmdSize];
+        u8* tmdBlob = reinterpret_cast<u8*>(
+            Slab::Alloc(tmdSize, Slab::Heap::System));
         memcpy(tmdBlob, tmd, tmdSize);
         tmd = reinterpret_cast<ES::TMD*>(tmdBlob);
 
@@ -275,6 +472,9 @@ static ES::ESError ReqIoctlv(ES::ESIoctl cmd, u32 inCount, u32 outCount,
             s_ctgpStubCid = tmd->getContents()[i].cid;
             memcpy(tmd->getContents()[i].hash, System::s_dolHash, 0x14);
             tmd->getContents()[i].size = System::s_dolSize;
+
+            // Title key and IV are known now, get a head start on the stub
+            StubCryptStart();
         }
 
         vec[0].data = tmdBlob;
@@ -283,6 +483,7 @@ static ES::ESError ReqIoctlv(ES::ESIoctl cmd, u32 inCount, u32 outCount,
         auto ret = ES::ESError(
             ES::sInstance->m_rm.ioctlv(cmd, inCount, outCount, vec));
         skipSignCheck = false;
+        Slab::Free(tmdBlob, Slab::Heap::System);
 
         PRINT(IOS_EmuES, INFO, "ret: %d", ret);
         return ret;
@@ -373,37 +574,9 @@ static ES::ESError ReqIoctlv(ES::ESIoctl cmd, u32 inCount, u32 outCount,
 
             s_ctgpStubCfd = -1;
 
-            u8 key[16] = {};
-            u8 iv[16] = {};
-
-            memcpy(key, s_ctgpTitleKey, 16);
-            iv[0] = (s_ctgpStubIndex >> 8) & 0xFF;
-            iv[1] = s_ctgpStubIndex & 0xFF;
-
-            static constexpr u32 WriteSize = 0x1000;
-            u8* cryptData = new u8[WriteSize];
-
-            for (u32 pos = 0; pos < System::s_dolSize; pos += WriteSize) {
-                u32 size = std::min(System::s_dolSize - pos, WriteSize);
-
-                auto aesRet = AES::sInstance->Encrypt(
-                    key, iv, System::s_dolData + pos, size, cryptData);
-                if (aesRet != 0) {
-                    PRINT(IOS_EmuES, ERROR, "AES encryption failed: %d",
-                          aesRet);
-                    delete[] cryptData;
-                    return ES::ESError::Invalid;
-                }
-
-                auto esRet =
-                    ES::sInstance->AddContentData(cfd, cryptData, size);
-                if (esRet != ES::ESError::OK) {
-                    PRINT(IOS_EmuES, ERROR, "ES AddContentData failed: %d",
-                          esRet);
-                    delete[] cryptData;
-                    return esRet;
-                }
-            }
+            auto esRet = StubCryptWrite(cfd);
+            if (esRet != ES::ESError::OK)
+                return esRet;
 
             PRINT(IOS_EmuES, INFO, "Successfully imported our stub");
         }
@@ -469,10 +642,16 @@ static ES::ESError ReqIoctlv(ES::ESIoctl cmd, u32 inCount, u32 outCount,
         }
 
         // Nuclear strategy, fixes the crash on second boot, lol
+        BootTimeline::Stamp(BOOT_IOS_LAUNCH_TITLE);
         memset((void*)0x00004000, 0, 0x01800000 - 0x4000);
+        BootTimeline::Stamp(BOOT_IOS_MEM1_CLEARED);
         // Flushing is pointless here as IOS reload flushes the whole cache
         // IOS_FlushDCache((void*)0x00004000, 0x01800000 - 0x4000);
 
+        BootTimeline::Report();
+        MemStats::WriteToLog();
+        Profiler::WriteToLog();
+
         PRINT(IOS_EmuES, INFO, "LaunchTitle: Launching %016llX...", titleID);
         return ES::sInstance->LaunchTitle(titleID, &view);
     }
@@ -587,6 +766,8 @@ s32 ThreadEntry(void* arg)
     s32 ret = IOS_RegisterResourceManager("~dev/es", queue.id());
     assert(ret == IOSError::OK);
 
+    new Thread(StubCryptThreadEntry, nullptr, nullptr, 0x800, 40);
+
     IPCLog::sInstance->Notify(2);
     while (true) {
         IOS::Request* req = queue.receive();
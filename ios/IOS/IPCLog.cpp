@@ -4,21 +4,118 @@
 // SPDX-License-Identifier: MIT
 
 #include "IPCLog.hpp"
+#include <Debug/BootTimeline.h>
 #include <Debug/Log.hpp>
 #include <IOS/System.hpp>
+#include <System/MemStats.hpp>
+#include <algorithm>
 #include <cstring>
 
 IPCLog* IPCLog::sInstance;
 
-IPCLog::IPCLog() : m_ipcQueue(8), m_responseQueue(1), m_startRequestQueue(1)
+IPCLog::IPCLog()
+    : m_ipcQueue(8), m_responseQueue(1), m_startRequestQueue(1),
+      m_ring(nullptr), m_ringWaitReq(nullptr)
 {
     s32 ret = IOS_RegisterResourceManager("/dev/saoirse", m_ipcQueue.id());
     if (ret < 0)
         AbortColor(YUV_WHITE);
+
+    BootTimeline::Stamp(BOOT_IOS_SAOIRSE_READY);
+
+    // Opens are answered once Run starts, the PPC can send them now
+    write32(Log::IPCLogReadyAddr, Log::IPCLogReadyMagic);
+    IOS_FlushDCache(reinterpret_cast<void*>(Log::IPCLogReadyAddr), 4);
+}
+
+/*
+ * Append a record to the shared ring. Must be called with m_ringMutex held.
+ * Returns false if there is not enough free space.
+ */
+bool IPCLog::RingWrite(Log::IPCLogReply type, const void* data, u32 len)
+{
+    Log::LogRing* ring = m_ring;
+    constexpr u32 size = Log::LogRing::DataSize;
+    const u32 recSize = Log::RecordSize(len);
+
+    IOS_InvalidateDCache(&ring->readPos, 32);
+    const u32 readPos = *(volatile u32*)&ring->readPos;
+    u32 writePos = ring->writePos;
+
+    u32 offset = writePos % size;
+    const u32 contig = size - offset;
+    const u32 needed = recSize <= contig ? recSize : contig + recSize;
+
+    if (size - (writePos - readPos) < needed)
+        return false;
+
+    if (recSize > contig) {
+        // Fill the end of the buffer and wrap around.
+        auto pad = reinterpret_cast<Log::LogRecord*>(ring->data + offset);
+        pad->type = Log::RingPad;
+        pad->len = contig - sizeof(Log::LogRecord);
+        IOS_FlushDCache(pad, sizeof(Log::LogRecord));
+        writePos += contig;
+        offset = 0;
+    }
+
+    auto rec = reinterpret_cast<Log::LogRecord*>(ring->data + offset);
+    rec->type = static_cast<u16>(type);
+    rec->len = len;
+    if (len != 0)
+        memcpy(rec + 1, data, len);
+    IOS_FlushDCache(rec, recSize);
+
+    // Publish the record only after its data has been written back.
+    ring->writePos = writePos + recSize;
+    IOS_FlushDCache(ring, 32);
+    return true;
+}
+
+/*
+ * Send a record through the shared ring and ring the doorbell if the PPC is
+ * waiting on it. If 'block' is set, wait for free space instead of dropping
+ * the record. Returns false if no ring is registered.
+ */
+bool IPCLog::RingSend(Log::IPCLogReply type, const void* data, u32 len,
+                      bool block)
+{
+    while (true) {
+        m_ringMutex.lock();
+        if (m_ring == nullptr) {
+            m_ringMutex.unlock();
+            return false;
+        }
+
+        bool written = RingWrite(type, data, len);
+        IOS::Request* doorbell = nullptr;
+        if (written) {
+            doorbell = m_ringWaitReq;
+            m_ringWaitReq = nullptr;
+        } else if (!block) {
+            // Let the PPC know it missed something.
+            m_ring->dropCount++;
+            IOS_FlushDCache(m_ring, 32);
+        }
+        m_ringMutex.unlock();
+
+        if (doorbell != nullptr)
+            doorbell->reply(IOSError::OK);
+
+        if (written || !block)
+            return true;
+
+        // Events must not be lost, wait for the PPC to drain the ring.
+        usleep(1000);
+    }
 }
 
 void IPCLog::Print(const char* buffer)
 {
+    u32 len = std::min<u32>(strlen(buffer), printSize - 1);
+    if (RingSend(Log::IPCLogReply::Print, buffer, len + 1, false))
+        return;
+
     IOS::Request* req = m_responseQueue.receive();
     memcpy(req->ioctl.io, buffer, printSize);
     req->reply(0);
@@ -26,16 +123,26 @@ void IPCLog::Print(const char* buffer)
 
 void IPCLog::Notify(u32 id)
 {
-    IOS::Request* req = m_responseQueue.receive();
+    if (id <= BOOT_IOS_NOTIFY_4 - BOOT_IOS_NOTIFY_0)
+        BootTimeline::Stamp(BOOT_IOS_NOTIFY_0 + id);
+
     u32 id32 = u32(id);
+    if (RingSend(Log::IPCLogReply::Notice, &id32, sizeof(u32), true))
+        return;
+
+    IOS::Request* req = m_responseQueue.receive();
     memcpy(req->ioctl.io, &id32, sizeof(u32));
     req->reply(1);
 }
 
 void IPCLog::SetLaunchState(LaunchError state)
 {
-    IOS::Request* req = m_responseQueue.receive();
     u32 state32 = u32(state);
+    if (RingSend(Log::IPCLogReply::SetLaunchState, &state32, sizeof(u32),
+                 true))
+        return;
+
+    IOS::Request* req = m_responseQueue.receive();
     memcpy(req->ioctl.io, &state32, sizeof(u32));
     req->reply(3);
 }
@@ -62,6 +169,19 @@ void IPCLog::HandleRequest(IOS::Request* req)
 
     case IOS::Command::Close:
         Log::ipcLogEnabled = false;
+
+        // Don't block here, the PPC can't drain the ring without this thread
+        // answering its doorbell. It will drain once more when the doorbell
+        // fails on the closed handle.
+        if (RingSend(Log::IPCLogReply::Close, nullptr, 0, false)) {
+            m_ringMutex.lock();
+            m_ring = nullptr;
+            m_ringWaitReq = nullptr;
+            m_ringMutex.unlock();
+            req->reply(IOSError::OK);
+            break;
+        }
+
         // Wait for any ongoing requests to finish. TODO: This could be done
         // better with a mutex maybe?
         usleep(10000);
@@ -103,6 +223,63 @@ void IPCLog::HandleRequest(IOS::Request* req)
             req->reply(IOSError::OK);
             break;
 
+        case Log::IPCLogIoctl::RegisterLogRing: {
+            // Shared memory ring in MEM2, replaces RegisterPrintHook
+            auto ring = reinterpret_cast<Log::LogRing*>(req->ioctl.in);
+            if (req->ioctl.in_len != sizeof(Log::LogRing) ||
+                !aligned(ring, 32) || !in_mem2(ring)) {
+                req->reply(IOSError::Invalid);
+                break;
+            }
+
+            IOS_InvalidateDCache(ring, 64);
+            if (ring->magic != Log::LogRing::MAGIC || ring->writePos != 0 ||
+                ring->readPos != 0) {
+                req->reply(IOSError::Invalid);
+                break;
+            }
+
+            m_ringMutex.lock();
+            m_ring = ring;
+            m_ringWaitReq = nullptr;
+            m_ringMutex.unlock();
+            req->reply(IOSError::OK);
+            break;
+        }
+
+        case Log::IPCLogIoctl::WaitLogRing:
+            // Doorbell, replied to once the ring has something to read
+            m_ringMutex.lock();
+            if (m_ring == nullptr || m_ringWaitReq != nullptr) {
+                m_ringMutex.unlock();
+                req->reply(IOSError::Invalid);
+                break;
+            }
+
+            IOS_InvalidateDCache(&m_ring->readPos, 32);
+            if (*(volatile u32*)&m_ring->readPos != m_ring->writePos) {
+                m_ringMutex.unlock();
+                req->reply(IOSError::OK);
+                break;
+            }
+
+            m_ringWaitReq = req;
+            m_ringMutex.unlock();
+            break;
+
+        case Log::IPCLogIoctl::GetMemReport:
+            if (req->ioctl.io_len != sizeof(Log::MemReport) ||
+                !aligned(req->ioctl.io, 32)) {
+                req->reply(IOSError::Invalid);
+                break;
+            }
+
+            MemStats::GetReport(
+                reinterpret_cast<Log::MemReport*>(req->ioctl.io));
+            IOS_FlushDCache(req->ioctl.io, sizeof(Log::MemReport));
+            req->reply(IOSError::OK);
+            break;
+
         default:
             req->reply(IOSError::Invalid);
             break;
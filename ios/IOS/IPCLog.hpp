@@ -4,6 +4,8 @@
 // SPDX-License-Identifier: MIT
 
 #pragma once
+#include <Debug/Log.hpp>
+#include <Debug/LogRing.hpp>
 #include <System/LaunchError.hpp>
 #include <System/OS.hpp>
 #include <System/Types.h>
@@ -23,10 +25,25 @@ public:
 
     void WaitForStartRequest(void** dolAddr, u32* dolSize);
 
+#ifdef TARGET_HOST
+    // Wait for the next Notify, for host drivers standing in for the PPC
+    s32 WaitForNotify(u32 usec);
+#endif
+
 protected:
     void HandleRequest(IOS::Request* req);
 
+    bool RingWrite(Log::IPCLogReply type, const void* data, u32 len);
+    bool RingSend(Log::IPCLogReply type, const void* data, u32 len,
+                  bool block);
+
     Queue<IOS::Request*> m_ipcQueue;
     Queue<IOS::Request*> m_responseQueue;
     Queue<int> m_startRequestQueue;
+
+    // Shared memory ring registered by the PPC, if any. Protected by
+    // m_ringMutex along with the pending doorbell request.
+    Log::LogRing* m_ring;
+    IOS::Request* m_ringWaitReq;
+    Mutex m_ringMutex;
 };
@@ -40,16 +40,23 @@ s32 IOS_SetThreadPriority(s32 threadid, u32 priority);
 /* <----------
  * IOS Message
  * ----------> */
-s32 IOS_CreateMessageQueue(u32* buf, u32 msg_count);
+#ifdef TARGET_HOST
+// Wide enough to carry a pointer in the 64-bit host build
+typedef uintptr_t IOSMessage;
+#else
+typedef u32 IOSMessage;
+#endif
+
+s32 IOS_CreateMessageQueue(IOSMessage* buf, u32 msg_count);
 s32 IOS_DestroyMessageQueue(s32 queue_id);
-s32 IOS_SendMessage(s32 queue_id, u32 message, u32 flags);
-s32 IOS_JamMessage(s32 queue_id, u32 message, u32 flags);
-s32 IOS_ReceiveMessage(s32 queue_id, u32* message, u32 flags);
+s32 IOS_SendMessage(s32 queue_id, IOSMessage message, u32 flags);
+s32 IOS_JamMessage(s32 queue_id, IOSMessage message, u32 flags);
+s32 IOS_ReceiveMessage(s32 queue_id, IOSMessage* message, u32 flags);
 
 /* <----------
  * IOS Timer
  * ----------> */
-s32 IOS_CreateTimer(s32 usec, s32 repeat_usec, s32 queue, u32 msg);
+s32 IOS_CreateTimer(s32 usec, s32 repeat_usec, s32 queue, IOSMessage msg);
 s32 IOS_RestartTimer(s32 timer, s32 usec, s32 repeat_usec);
 s32 IOS_StopTimer(s32 timer);
 s32 IOS_DestroyTimer(s32 timer);
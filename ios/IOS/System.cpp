@@ -6,6 +6,7 @@
 #include "System.hpp"
 #include <CTGP/EmuHID.hpp>
 #include <DVD/DI.hpp>
+#include <Debug/BootTimeline.h>
 #include <Debug/Log.hpp>
 #include <Disk/DeviceMgr.hpp>
 #include <Disk/SDCard.hpp>
@@ -15,14 +16,19 @@
 #include <IOS/IPCLog.hpp>
 #include <IOS/Patch.hpp>
 #include <IOS/Syscalls.h>
+#include <IOS/TimerMgr.hpp>
 #include <System/AES.hpp>
 #include <System/Config.hpp>
 #include <System/ES.hpp>
 #include <System/Hollywood.hpp>
+#include <System/MemStats.hpp>
 #include <System/OS.hpp>
+#include <System/Profiler.hpp>
 #include <System/SHA.hpp>
+#include <System/Slab.hpp>
 #include <System/Types.h>
 #include <System/Util.h>
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 
@@ -40,54 +46,109 @@ void StaticInit()
     }
 }
 
-void* operator new(std::size_t size)
+#ifdef HEAP_STATS
+
+/*
+ * Every system heap block starts with a header recording its size and call
+ * site for MemStats. The header size keeps the returned block aligned.
+ */
+struct HeapHeader {
+    u32 size;
+    u16 site;
+    u16 offset;
+};
+
+static void* HeapAlloc(std::size_t size, u32 align, void* lr)
 {
-    void* block = IOS_Alloc(System::GetHeap(), size);
+    const u32 offset = std::max<u32>(align, 32);
+    u8* block = reinterpret_cast<u8*>(
+        IOS_AllocAligned(System::GetHeap(), size + offset, offset));
     assert(block != nullptr);
-    return block;
+
+    HeapHeader* header = reinterpret_cast<HeapHeader*>(block + offset) - 1;
+    header->size = size + offset;
+    header->offset = offset;
+    header->site = MemStats::OnAlloc(reinterpret_cast<u32>(lr), header->size);
+    return block + offset;
 }
 
-void* operator new[](std::size_t size)
+static void HeapFree(void* ptr)
+{
+    if (ptr == nullptr)
+        return;
+
+    HeapHeader* header = reinterpret_cast<HeapHeader*>(ptr) - 1;
+    MemStats::OnFree(header->site, header->size);
+    IOS_Free(System::GetHeap(), reinterpret_cast<u8*>(ptr) - header->offset);
+}
+
+#else
+
+static void* HeapAlloc(std::size_t size, u32 align, void* lr)
 {
-    void* block = IOS_Alloc(System::GetHeap(), size);
+    void* block = IOS_AllocAligned(System::GetHeap(), size,
+                                   std::max<u32>(align, 32));
     assert(block != nullptr);
     return block;
 }
 
+static void HeapFree(void* ptr)
+{
+    IOS_Free(System::GetHeap(), ptr);
+}
+
+#endif
+
+void* operator new(std::size_t size)
+{
+    return HeapAlloc(size, 32, __builtin_return_address(0));
+}
+
+void* operator new[](std::size_t size)
+{
+    return HeapAlloc(size, 32, __builtin_return_address(0));
+}
+
 void* operator new(std::size_t size, std::align_val_t align)
 {
-    void* block =
-        IOS_AllocAligned(System::GetHeap(), size, static_cast<u32>(align));
-    assert(block != nullptr);
-    return block;
+    return HeapAlloc(size, static_cast<u32>(align),
+                     __builtin_return_address(0));
 }
 
 void* operator new[](std::size_t size, std::align_val_t align)
 {
-    void* block =
-        IOS_AllocAligned(System::GetHeap(), size, static_cast<u32>(align));
-    assert(block != nullptr);
-    return block;
+    return HeapAlloc(size, static_cast<u32>(align),
+                     __builtin_return_address(0));
 }
 
 void operator delete(void* ptr)
 {
-    IOS_Free(System::GetHeap(), ptr);
+    HeapFree(ptr);
 }
 
 void operator delete[](void* ptr)
 {
-    IOS_Free(System::GetHeap(), ptr);
+    HeapFree(ptr);
 }
 
 void operator delete(void* ptr, std::size_t size)
 {
-    IOS_Free(System::GetHeap(), ptr);
+    HeapFree(ptr);
 }
 
 void operator delete[](void* ptr, std::size_t size)
 {
-    IOS_Free(System::GetHeap(), ptr);
+    HeapFree(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t align)
+{
+    HeapFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t align)
+{
+    HeapFree(ptr);
 }
 
 extern "C" void __abort(u32 lr)
@@ -140,28 +201,7 @@ void usleep(u32 usec)
     if (usec == 0)
         return;
 
-    u32 queueData;
-    const s32 queue = IOS_CreateMessageQueue(&queueData, 1);
-    if (queue < 0) {
-        PRINT(IOS, ERROR, "Failed to create message queue: %d", queue);
-        abort();
-    }
-
-    const s32 timer = IOS_CreateTimer(usec, 0, queue, 1);
-    if (timer < 0) {
-        PRINT(IOS, ERROR, "Failed to create timer: %d", timer);
-        abort();
-    }
-
-    u32 msg;
-    const s32 ret = IOS_ReceiveMessage(queue, &msg, 0);
-    if (ret < 0 || msg != 1) {
-        PRINT(IOS, ERROR, "IOS_ReceiveMessage failed: %d", ret);
-        abort();
-    }
-
-    IOS_DestroyTimer(timer);
-    IOS_DestroyMessageQueue(queue);
+    TimerMgr::sInstance->Sleep(usec);
 }
 
 bool s_timerStarted = false;
@@ -176,25 +216,18 @@ struct {
     (((u64)(tick1) < (u64)(tick0)) ? ((u64)-1 - (u64)(tick0) + (u64)(tick1))   \
                                    : ((u64)(tick1) - (u64)(tick0)))
 
-static s32 TimerThreadEntry([[maybe_unused]] void* arg)
+static void UpdateTimeBase([[maybe_unused]] void* arg)
 {
-    // 32 minute interval
-    static constexpr u32 TimerInterval = 1000 * (60 * 32);
+    u8 prev = s_timerIndex;
+    u8 next = prev ^ 1;
 
-    while (true) {
-        usleep(TimerInterval);
+    u32 prevTimer = s_timerCtx[prev].m_timer;
+    u32 nextTimer = ACRReadTrusted(ACRReg::TIMER);
 
-        u8 prev = s_timerIndex;
-        u8 next = prev ^ 1;
-
-        u32 prevTimer = s_timerCtx[prev].m_timer;
-        u32 nextTimer = ACRReadTrusted(ACRReg::TIMER);
-
-        s_timerCtx[next].m_tick =
-            s_timerCtx[prev].m_tick + diff_ticks(prevTimer, nextTimer);
-        s_timerCtx[next].m_timer = nextTimer;
-        s_timerIndex = next;
-    }
+    s_timerCtx[next].m_tick =
+        s_timerCtx[prev].m_tick + diff_ticks(prevTimer, nextTimer);
+    s_timerCtx[next].m_timer = nextTimer;
+    s_timerIndex = next;
 }
 
 void System::SetTime(u32 hwTimerVal, u64 epoch)
@@ -205,7 +238,12 @@ void System::SetTime(u32 hwTimerVal, u64 epoch)
 
     if (!s_timerStarted) {
         s_timerStarted = true;
-        new Thread(TimerThreadEntry, nullptr, nullptr, 0x400, 1);
+
+        // 16 minute interval, well within the 37 minute timer wrap
+        static constexpr u32 TimerInterval = 1000 * 1000 * (60 * 16);
+        static TimerMgr::Entry s_timeBaseEntry;
+        TimerMgr::sInstance->SchedulePeriodic(&s_timeBaseEntry, TimerInterval,
+                                              UpdateTimeBase, nullptr);
     }
 }
 
@@ -259,6 +297,62 @@ void* System::UnalignedMemcpy(void* dest, const void* src, size_t len)
     return dest;
 }
 
+/*
+ * Atomically exchange a word in memory. SWP is ARM only and is the only
+ * atomic the ARM926 has.
+ */
+// clang-format off
+ATTRIBUTE_TARGET(arm)
+ATTRIBUTE_NOINLINE
+ASM_FUNCTION(u32 AtomicSwap(volatile u32* ptr, u32 value),
+    // r0 = ptr, r1 = value
+    swp     r2, r1, [r0];
+    mov     r0, r2;
+    bx      lr
+)
+// clang-format on
+
+/*
+ * Mask IRQ and FIQ and return the CPSR from before. Writes to the mask bits
+ * are ignored in user mode, check IRQMaskable first.
+ */
+// clang-format off
+ATTRIBUTE_TARGET(arm)
+ATTRIBUTE_NOINLINE
+ASM_FUNCTION(u32 IRQDisable(),
+    mrs     r0, cpsr;
+    orr     r1, r0, #0xC0;
+    msr     cpsr_c, r1;
+    bx      lr
+)
+// clang-format on
+
+/*
+ * Restore the interrupt mask from a CPSR returned by IRQDisable.
+ */
+// clang-format off
+ATTRIBUTE_TARGET(arm)
+ATTRIBUTE_NOINLINE
+ASM_FUNCTION(void IRQRestore(u32 cpsr),
+    // r0 = cpsr
+    mrs     r1, cpsr;
+    bic     r1, r1, #0xC0;
+    and     r0, r0, #0xC0;
+    orr     r1, r1, r0;
+    msr     cpsr_c, r1;
+    bx      lr
+)
+// clang-format on
+
+// clang-format off
+ATTRIBUTE_TARGET(arm)
+ATTRIBUTE_NOINLINE
+ASM_FUNCTION(u32 ReadCPSR(),
+    mrs     r0, cpsr;
+    bx      lr
+)
+// clang-format on
+
 void KernelWrite(u32 address, u32 value)
 {
     const s32 queue = IOS_CreateMessageQueue((u32*)address, 0x40000000);
@@ -275,6 +369,53 @@ void* System::s_dolData = nullptr;
 u32 System::s_dolSize = 0;
 u8 System::s_dolHash[0x14] = {};
 
+/*
+ * Copy the DOL out of PPC memory and hash it in the same pass. Each 64 KiB
+ * slice is hashed by /dev/sha while the next one is being copied. The SHA
+ * engine can't be left running in the background like this without keeping
+ * IOSC out of it for the whole time.
+ */
+static s32 CopyAndHashDOL(void* dst, const void* src, u32 size, u8* hashOut)
+{
+    static constexpr u32 SliceSize = 0x10000;
+
+    u8* out = reinterpret_cast<u8*>(dst);
+    const u8* in = reinterpret_cast<const u8*>(src);
+
+    SHA::Context ctx ATTRIBUTE_ALIGN(32);
+    s32 ret = SHA::sInstance->Init(&ctx);
+    if (ret != IOSError::OK)
+        return ret;
+
+    Queue<IOS::Request*> queue(1);
+    IOS::Request req = {};
+    IOS::IOVector<1, 2> vec;
+    bool pending = false;
+
+    // The last slice, possibly empty, always finishes the hash
+    for (u32 pos = 0;; pos += SliceSize) {
+        const u32 len = std::min(size - pos, SliceSize);
+        memcpy(out + pos, in + pos, len);
+
+        if (pending) {
+            queue.receive();
+            pending = false;
+            if (req.result != IOSError::OK)
+                return req.result;
+        }
+
+        if (pos + len == size)
+            return SHA::sInstance->Final(&ctx, out + pos, len, hashOut);
+
+        req = {};
+        ret = SHA::sInstance->UpdateAsync(&ctx, &vec, out + pos, len, &queue,
+                                          &req);
+        if (ret != IOSError::OK)
+            return ret;
+        pending = true;
+    }
+}
+
 s32 SystemThreadEntry([[maybe_unused]] void* arg)
 {
     SHA::sInstance = new SHA();
@@ -299,6 +440,7 @@ s32 SystemThreadEntry([[maybe_unused]] void* arg)
     void* dolAddr = nullptr;
     u32 dolSize = 0;
     IPCLog::sInstance->WaitForStartRequest(&dolAddr, &dolSize);
+    const u32 startTime = ACRReadTrusted(ACRReg::TIMER);
     PRINT(IOS, INFO, "Starting up game IOS...");
 
     PatchIOSOpen();
@@ -306,20 +448,23 @@ s32 SystemThreadEntry([[maybe_unused]] void* arg)
     new Thread(EmuSDIO::ThreadEntry, nullptr, nullptr, 0x2000, 80);
 
     PRINT(IOS, INFO, "DOL size: %u", dolSize);
-    System::s_dolData = IOS::Alloc(dolSize);
+    // Aligned to a SHA-1 block so the engine can hash it in place
+    System::s_dolData =
+        IOS_AllocAligned(IOS::ipcHeap, round_up(dolSize, 32), 64);
     assert(System::s_dolData != nullptr);
 
     System::s_dolSize = dolSize;
-    memcpy(System::s_dolData, dolAddr, dolSize);
-    PRINT(IOS, INFO, "Copied DOL");
-
-    auto ret = SHA::sInstance->Calculate(System::s_dolData, System::s_dolSize,
-                                         System::s_dolHash);
+    auto ret = CopyAndHashDOL(System::s_dolData, dolAddr, dolSize,
+                              System::s_dolHash);
     PRINT(IOS, INFO, "sha ret: %d", ret);
     assert(ret >= 0);
 
     IPCLog::sInstance->Notify(4);
 
+    const u32 ticks = ACRReadTrusted(ACRReg::TIMER) - startTime;
+    PRINT(IOS, INFO, "Start request to notify: %u us",
+          u32(u64(ticks) * 128 / 243));
+
     // new Thread(EmuFS::ThreadEntry, nullptr, nullptr, 0x2000, 80);
     // new Thread(EmuDI::ThreadEntry, nullptr, nullptr, 0x2000, 80);
 
@@ -330,19 +475,28 @@ extern "C" void Entry([[maybe_unused]] void* arg)
 {
     static u8 systemHeapData[SystemHeapSize] ATTRIBUTE_ALIGN(32);
 
+    BootTimeline::Stamp(BOOT_IOS_ENTRY);
+
     // Create system heap
     s32 ret = IOS_CreateHeap(systemHeapData, sizeof(systemHeapData));
     if (ret < 0)
         AbortColor(YUV_YELLOW);
     System::SetHeap(ret);
 
+    MemStats::Init(SystemHeapSize);
+    Slab::Init();
+    TimerMgr::sInstance = new TimerMgr();
     Config::sInstance = new Config();
     IPCLog::sInstance = new IPCLog();
     Log::ipcLogEnabled = true;
 
+    // Runs above the priority this thread drops to
+    Profiler::Start();
+
     IOS_SetThreadPriority(0, 40);
 
     static u8 SystemThreadStack[0x800] ATTRIBUTE_ALIGN(32);
+    MemStats::PaintStack(SystemThreadStack, sizeof(SystemThreadStack));
 
     ret = IOS_CreateThread(
         SystemThreadEntry, nullptr,
@@ -350,6 +504,7 @@ extern "C" void Entry([[maybe_unused]] void* arg)
         sizeof(SystemThreadStack), 80, true);
     if (ret < 0)
         AbortColor(YUV_YELLOW);
+    MemStats::RegisterStack(ret, SystemThreadStack, sizeof(SystemThreadStack));
 
     // Set new thread CPSR with system mode enabled
     u32 cpsr = 0x1F | ((u32)(SystemThreadEntry)&1 ? 0x20 : 0);
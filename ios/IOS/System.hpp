@@ -64,6 +64,19 @@ public:
 
 void AbortColor(u32 color);
 void KernelWrite(u32 address, u32 value);
+u32 AtomicSwap(volatile u32* ptr, u32 value);
+u32 IRQDisable();
+void IRQRestore(u32 cpsr);
+u32 ReadCPSR();
+
+/*
+ * The IRQ mask can only be changed from a privileged mode. Threads start in
+ * user mode unless their CPSR is patched like SystemThread's.
+ */
+static inline bool IRQMaskable()
+{
+    return (ReadCPSR() & 0x1F) != 0x10;
+}
 
 EXTERN_C_START
 void abort();
@@ -0,0 +1,312 @@
+// TimerMgr.cpp - Shared IOS timer service
+//
+// SPDX-License-Identifier: MIT
+
+#include "TimerMgr.hpp"
+#include <Debug/Log.hpp>
+#include <IOS/Syscalls.h>
+#include <IOS/System.hpp>
+#include <System/Hollywood.hpp>
+#include <System/OS.hpp>
+
+TimerMgr* TimerMgr::sInstance;
+
+// IOS doesn't run more than this many threads at once
+static constexpr u32 MaxThreads = 100;
+
+// Queue ID + 1 for each thread, zero if not created yet
+static s32 s_waitQueue[MaxThreads];
+static IOSMessage s_waitQueueData[MaxThreads];
+
+/*
+ * The Hollywood timer runs at 243 MHz / 128. Deadlines are compared with a
+ * signed difference, so a delay must be less than half the timer period.
+ */
+static u32 UsecToTicks(u32 usec)
+{
+    const u64 ticks = u64(usec) * 243 / 128;
+    assert(ticks < 0x80000000);
+    return ticks;
+}
+
+static u32 TicksToUsec(u32 ticks)
+{
+    return (u64(ticks) * 128 + 242) / 243;
+}
+
+static u32 GetTicks()
+{
+    return ACRReadTrusted(ACRReg::TIMER);
+}
+
+TimerMgr::TimerMgr()
+{
+    m_head = nullptr;
+    m_threadId = -1;
+
+    m_queue = IOS_CreateMessageQueue(m_queueData, 8);
+    assert(m_queue >= 0);
+
+    m_lock = new Mutex;
+
+    m_timer = IOS_CreateTimer(0, 0, m_queue, 0);
+    assert(m_timer >= 0);
+
+    new Thread(ThreadEntry, reinterpret_cast<void*>(this), nullptr, 0x400,
+               120);
+}
+
+s32 TimerMgr::ThreadEntry(void* arg)
+{
+    TimerMgr* that = reinterpret_cast<TimerMgr*>(arg);
+    that->m_threadId = IOS_GetThreadId();
+
+    while (true) {
+        IOSMessage msg;
+        const s32 ret = IOS_ReceiveMessage(that->m_queue, &msg, 0);
+        assert(ret == IOS_SUCCESS);
+
+        // The timer may have been rearmed since it sent this, so a wakeup
+        // with nothing expired is fine.
+        that->Process();
+    }
+}
+
+/*
+ * Insert an entry into the deadline sorted list. Lock must be held.
+ */
+void TimerMgr::Insert(Entry* entry)
+{
+    Entry** it = &m_head;
+    while (*it != nullptr && s32((*it)->deadline - entry->deadline) <= 0)
+        it = &(*it)->next;
+
+    entry->next = *it;
+    *it = entry;
+}
+
+/*
+ * Program the hardware timer for the earliest deadline. Lock must be held.
+ */
+void TimerMgr::Arm()
+{
+    if (m_head == nullptr) {
+        IOS_StopTimer(m_timer);
+        return;
+    }
+
+    const s32 remaining = m_head->deadline - GetTicks();
+    const u32 usec = remaining > 0 ? TicksToUsec(remaining) : 0;
+    IOS_RestartTimer(m_timer, usec, 0);
+}
+
+void TimerMgr::Process()
+{
+    Entry* callbacks = nullptr;
+    Entry** tail = &callbacks;
+
+    m_lock->lock();
+    const u32 now = GetTicks();
+    while (m_head != nullptr && s32(m_head->deadline - now) <= 0) {
+        Entry* entry = m_head;
+        m_head = entry->next;
+
+        if (entry->callback == nullptr) {
+            // Marked first, as the owner may return as soon as the message is
+            // sent, and a Sleep entry lives on its stack. A send only fails
+            // on a full Receive queue, and then the owner can't return before
+            // its Cancel gets the lock we're holding.
+            const s32 queue = entry->queue;
+            const IOSMessage msg = entry->msg;
+            entry->delivered = true;
+
+            // Never block the service thread on a full queue. If the queue is
+            // full the receiver is about to wake up anyway.
+            if (IOS_SendMessage(queue, msg, 1) != IOS_SUCCESS)
+                entry->delivered = false;
+            continue;
+        }
+
+        entry->next = nullptr;
+        entry->running = true;
+        *tail = entry;
+        tail = &entry->next;
+    }
+    m_lock->unlock();
+
+    // Run callbacks without the lock so they can schedule timers themselves
+    while (callbacks != nullptr) {
+        Entry* entry = callbacks;
+        callbacks = entry->next;
+
+        entry->callback(entry->arg);
+
+        // Cancel may be waiting for this, so the entry can't be touched after
+        // running is cleared
+        m_lock->lock();
+        if (entry->period != 0 && !entry->cancelled) {
+            entry->deadline += entry->period;
+            Insert(entry);
+        }
+        entry->running = false;
+        m_lock->unlock();
+    }
+
+    m_lock->lock();
+    Arm();
+    m_lock->unlock();
+}
+
+/*
+ * Send msg to queue after usec microseconds.
+ */
+void TimerMgr::Schedule(Entry* entry, u32 usec, s32 queue,
+                        IOSMessage msg)
+{
+    entry->period = 0;
+    entry->queue = queue;
+    entry->msg = msg;
+    entry->callback = nullptr;
+    entry->arg = nullptr;
+    entry->delivered = false;
+    entry->running = false;
+    entry->cancelled = false;
+
+    m_lock->lock();
+    entry->deadline = GetTicks() + UsecToTicks(usec);
+    Insert(entry);
+    if (m_head == entry)
+        Arm();
+    m_lock->unlock();
+}
+
+/*
+ * Call callback from the service thread every usec microseconds. The callback
+ * must not block.
+ */
+void TimerMgr::SchedulePeriodic(Entry* entry, u32 usec, Callback callback,
+                                void* arg)
+{
+    entry->period = UsecToTicks(usec);
+    entry->queue = -1;
+    entry->msg = 0;
+    entry->callback = callback;
+    entry->arg = arg;
+    entry->delivered = false;
+    entry->running = false;
+    entry->cancelled = false;
+
+    m_lock->lock();
+    entry->deadline = GetTicks() + entry->period;
+    Insert(entry);
+    if (m_head == entry)
+        Arm();
+    m_lock->unlock();
+}
+
+/*
+ * Remove a scheduled entry. Returns false if its message was already
+ * delivered, in which case it is still waiting in the queue. If its callback
+ * is running this waits for it to return, unless called from the callback
+ * itself, where it returns false and the entry just isn't rescheduled.
+ */
+bool TimerMgr::Cancel(Entry* entry)
+{
+    bool removed = false;
+
+    m_lock->lock();
+    for (Entry** it = &m_head; *it != nullptr; it = &(*it)->next) {
+        if (*it == entry) {
+            *it = entry->next;
+            removed = true;
+            break;
+        }
+    }
+
+    if (!removed && entry->running) {
+        entry->cancelled = true;
+
+        if (IOS_GetThreadId() == m_threadId) {
+            m_lock->unlock();
+            return false;
+        }
+
+        // The service thread clears running under the lock once it's done
+        // with the entry
+        while (entry->running) {
+            m_lock->unlock();
+            Sleep(0);
+            m_lock->lock();
+        }
+        removed = true;
+    }
+    m_lock->unlock();
+
+    return removed || !entry->delivered;
+}
+
+/*
+ * Sleep the current thread on its own wait queue.
+ */
+void TimerMgr::Sleep(u32 usec)
+{
+    const s32 queue = GetWaitQueue();
+
+    Entry entry;
+    Schedule(&entry, usec, queue, 0);
+
+    IOSMessage msg;
+    const s32 ret = IOS_ReceiveMessage(queue, &msg, 0);
+    assert(ret == IOS_SUCCESS);
+}
+
+/*
+ * Receive from queue with a timeout. The timeout is delivered to the queue
+ * itself as token. A timeout that fires after a message was already received
+ * can't be taken back, so it is counted in staleCount and skipped by the next
+ * receive. Returns false on timeout.
+ */
+bool TimerMgr::Receive(s32 queue, IOSMessage* msg, u32 usec,
+                       u32* staleCount, IOSMessage token)
+{
+    Entry entry;
+    Schedule(&entry, usec, queue, token);
+
+    while (true) {
+        const s32 ret = IOS_ReceiveMessage(queue, msg, 0);
+        assert(ret == IOS_SUCCESS);
+
+        if (*msg != token)
+            break;
+
+        // Older stale timeouts are always ahead of ours in the queue
+        if (*staleCount == 0)
+            return false;
+        (*staleCount)--;
+    }
+
+    if (!Cancel(&entry))
+        (*staleCount)++;
+
+    return true;
+}
+
+/*
+ * Get the wait queue owned by the current thread, creating it on first use.
+ */
+s32 TimerMgr::GetWaitQueue()
+{
+    const s32 tid = IOS_GetThreadId();
+    assert(tid >= 0 && u32(tid) < MaxThreads);
+
+    if (s_waitQueue[tid] == 0) {
+        const s32 queue = IOS_CreateMessageQueue(&s_waitQueueData[tid], 1);
+        if (queue < 0) {
+            PRINT(IOS, ERROR, "Failed to create message queue: %d", queue);
+            abort();
+        }
+        s_waitQueue[tid] = queue + 1;
+    }
+
+    return s_waitQueue[tid] - 1;
+}
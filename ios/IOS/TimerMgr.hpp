@@ -0,0 +1,66 @@
+// TimerMgr.hpp - Shared IOS timer service
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <IOS/Syscalls.h>
+#include <System/Types.h>
+
+class Mutex;
+
+/*
+ * Multiplexes sleeps, receive timeouts and periodic callbacks over a single
+ * IOS timer and service thread, so waiting doesn't create and destroy kernel
+ * objects every time.
+ */
+class TimerMgr
+{
+public:
+    typedef void (*Callback)(void* arg);
+
+    struct Entry {
+        Entry* next;
+        u32 deadline; // Hollywood timer ticks
+        u32 period; // Ticks, zero if one-shot
+        s32 queue;
+        IOSMessage msg;
+        Callback callback;
+        void* arg;
+        bool delivered;
+        // Callback is running on the service thread, off the list
+        bool running;
+        // Cancelled while running, so it isn't rescheduled
+        bool cancelled;
+    };
+
+    TimerMgr();
+
+    void Sleep(u32 usec);
+    void Schedule(Entry* entry, u32 usec, s32 queue, IOSMessage msg);
+    void SchedulePeriodic(Entry* entry, u32 usec, Callback callback,
+                          void* arg);
+    bool Cancel(Entry* entry);
+    bool Receive(s32 queue, IOSMessage* msg, u32 usec, u32* staleCount,
+                 IOSMessage token);
+
+    static s32 GetWaitQueue();
+
+    static TimerMgr* sInstance;
+
+private:
+    static s32 ThreadEntry(void* arg);
+
+    void Insert(Entry* entry);
+    void Arm();
+    void Process();
+
+    IOSMessage m_queueData[8];
+    s32 m_queue;
+    s32 m_timer;
+    s32 m_threadId;
+
+    // Sorted by deadline, protected by m_lock
+    Mutex* m_lock;
+    Entry* m_head;
+};
@@ -63,10 +63,184 @@ void LoaderAssertFail(int line)
 static s32 gFileRMQueue = -1;
 static bool gIsOpened = false;
 
+// VFile set up by IOSBoot::Launch on the PPC.
+constexpr u32 VFileAddr = 0x11000000;
+constexpr u32 VFileLength = VFileAddr + 0x04;
+constexpr u32 VFileData = VFileAddr + 0x10;
+constexpr u32 VFileIdent = VFileAddr + 0x14;
+
 // Memory file information.
 static u8* gFileAddr = nullptr;
 static u32 gFileSize = 0;
 static u32 gFilePos = 0;
+// Patched start of the file, read in place of the original.
+static u8 gFileIdent[12];
+
+// Chunked LZ4, written by compress.py in this directory.
+constexpr u32 LZ4CMagic = 0x4C5A3443; /* LZ4C */
+constexpr u32 LZ4CHeaderSize = 0x20;
+constexpr u32 LZ4CMaxChunkSize = 0x4000;
+
+static bool gCompressed = false;
+static u32 gChunkSize = 0;
+static u32 gChunkCount = 0;
+static s32 gCachedChunk = -1;
+static u8 gChunkBuffer[LZ4CMaxChunkSize] ATTRIBUTE_ALIGN(32);
+
+// The archive only aligns its members to 2 bytes.
+static u32 ReadBE32(const u8* data)
+{
+    return (u32(data[0]) << 24) | (u32(data[1]) << 16) | (u32(data[2]) << 8) |
+           data[3];
+}
+
+static u32 ReadLength(const u8*& src, const u8* srcEnd, u32 length)
+{
+    if (length != 15)
+        return length;
+
+    u8 byte;
+    do {
+        if (src >= srcEnd)
+            return ~0;
+        byte = *src++;
+        length += byte;
+    } while (byte == 255);
+
+    return length;
+}
+
+/*
+ * Decode an LZ4 block into dst. Returns the decoded length, or -1 if the block
+ * is malformed or doesn't fit.
+ */
+static s32 LZ4Decode(u8* dst, u32 dstLen, const u8* src, u32 srcLen)
+{
+    const u8* srcEnd = src + srcLen;
+    u8* out = dst;
+    u8* outEnd = dst + dstLen;
+
+    while (src < srcEnd) {
+        const u32 token = *src++;
+
+        const u32 litLen = ReadLength(src, srcEnd, token >> 4);
+        if (litLen > u32(srcEnd - src) || litLen > u32(outEnd - out))
+            return -1;
+
+        memcpy(out, src, litLen);
+        out += litLen;
+        src += litLen;
+
+        // The last sequence has no match.
+        if (src == srcEnd)
+            break;
+
+        if (srcEnd - src < 2)
+            return -1;
+
+        const u32 offset = src[0] | (src[1] << 8);
+        src += 2;
+
+        u32 matchLen = ReadLength(src, srcEnd, token & 0xF);
+        if (matchLen == ~0u)
+            return -1;
+        matchLen += 4;
+
+        if (offset == 0 || offset > u32(out - dst) ||
+            matchLen > u32(outEnd - out))
+            return -1;
+
+        const u8* match = out - offset;
+        if (offset >= matchLen) {
+            memcpy(out, match, matchLen);
+            out += matchLen;
+        } else {
+            // Overlaps, which repeats the last offset bytes.
+            while (matchLen-- != 0)
+                *out++ = *match++;
+        }
+    }
+
+    return out - dst;
+}
+
+static bool DecodeChunk(u32 chunk, u8* dst, u32 len)
+{
+    const u8* offsets = gFileAddr + LZ4CHeaderSize + chunk * 4;
+    const u32 start = ReadBE32(offsets);
+    const u32 srcLen = ReadBE32(offsets + 4) - start;
+
+    // Stored as is if it didn't compress.
+    if (srcLen == len) {
+        memcpy(dst, gFileAddr + start, len);
+        return true;
+    }
+
+    return LZ4Decode(dst, len, gFileAddr + start, srcLen) == s32(len);
+}
+
+/*
+ * Read from the compressed file. Whole chunks are decoded straight into the
+ * destination, others through gChunkBuffer, which is kept for the next read.
+ */
+static bool ReadCompressed(u8* data, u32 pos, u32 len)
+{
+    while (len != 0) {
+        const u32 chunk = pos / gChunkSize;
+        const u32 chunkStart = chunk * gChunkSize;
+        const u32 chunkLen = gFileSize - chunkStart < gChunkSize
+                                 ? gFileSize - chunkStart
+                                 : gChunkSize;
+        const u32 offset = pos - chunkStart;
+        const u32 copyLen =
+            len < chunkLen - offset ? len : chunkLen - offset;
+
+        if (offset == 0 && copyLen == chunkLen) {
+            if (!DecodeChunk(chunk, data, chunkLen))
+                return false;
+        } else {
+            if (gCachedChunk != s32(chunk)) {
+                gCachedChunk = -1;
+                if (!DecodeChunk(chunk, gChunkBuffer, chunkLen))
+                    return false;
+                gCachedChunk = chunk;
+            }
+            memcpy(data, gChunkBuffer + offset, copyLen);
+        }
+
+        data += copyLen;
+        pos += copyLen;
+        len -= copyLen;
+    }
+
+    return true;
+}
+
+/*
+ * Check for a compressed module and invalidate the file in the cache. The
+ * file is the PPC's archive in place, which the PPC only ever read and so
+ * never had dirty in its cache, but IOS could have stale lines.
+ */
+static void OpenFile()
+{
+    IOS_InvalidateDCache(gFileAddr, LZ4CHeaderSize);
+
+    if (ReadBE32(gFileAddr) != LZ4CMagic) {
+        IOS_InvalidateDCache(gFileAddr, gFileSize);
+        return;
+    }
+
+    gChunkSize = ReadBE32(gFileAddr + 0x08);
+    gChunkCount = ReadBE32(gFileAddr + 0x0C);
+    LOADER_ASSERT(gChunkSize != 0 && gChunkSize <= LZ4CMaxChunkSize);
+    LOADER_ASSERT(gChunkCount == (gFileSize + gChunkSize - 1) / gChunkSize);
+
+    // The offset table, and then the rest of the file it ends at.
+    IOS_InvalidateDCache(gFileAddr + LZ4CHeaderSize, (gChunkCount + 1) * 4);
+    IOS_InvalidateDCache(gFileAddr, ReadBE32(gFileAddr + LZ4CHeaderSize +
+                                             gChunkCount * 4));
+    gCompressed = true;
+}
 
 static s32 ReqOpen(const char* path, u32 mode)
 {
@@ -114,7 +288,17 @@ static s32 ReqRead(s32 fd, void* data, u32 len)
     LOADER_PRINT(INFO, "Enter memcpy");
 
     // Read from the memory file.
-    memcpy(data, gFileAddr + gFilePos, len);
+    if (!gCompressed) {
+        memcpy(data, gFileAddr + gFilePos, len);
+    } else if (!ReadCompressed(static_cast<u8*>(data), gFilePos, len)) {
+        LOADER_PRINT(ERROR, "Failed to decompress at 0x%X", gFilePos);
+        return ISFSError::Invalid;
+    }
+
+    if (gFilePos < sizeof(gFileIdent)) {
+        const u32 identLen = sizeof(gFileIdent) - gFilePos;
+        memcpy(data, gFileIdent + gFilePos, len < identLen ? len : identLen);
+    }
     gFilePos += len;
     LOADER_PRINT(INFO, "Exit memcpy");
 
@@ -227,8 +411,11 @@ static s32 FileRMThreadEntry([[maybe_unused]] void* arg)
 {
     LOADER_PRINT(INFO, "File RM thread entry");
 
-    gFileSize = read32(0x11000004);
-    gFileAddr = reinterpret_cast<u8*>(0x11000020);
+    gFileSize = read32(VFileLength);
+    gFileAddr = reinterpret_cast<u8*>(read32(VFileData));
+    memcpy(gFileIdent, reinterpret_cast<const void*>(VFileIdent),
+           sizeof(gFileIdent));
+    OpenFile();
 
     while (true) {
         IOSRequest* req;
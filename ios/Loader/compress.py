@@ -0,0 +1,118 @@
+# compress.py - Compress the IOS module for Loader.cpp
+#
+# SPDX-License-Identifier: MIT
+#
+# Usage: compress.py saoirse_ios.elf saoirse_ios.elf.lz4
+#
+# The file is split into chunks that are each compressed as a separate LZ4
+# block, so the loader can seek. Everything is big endian:
+#   0x00 magic 'LZ4C'
+#   0x04 uncompressed size
+#   0x08 chunk size
+#   0x0C chunk count
+#   0x10 first 16 bytes of the uncompressed file
+#   0x20 chunk count + 1 offsets from the start of the file, the last one is
+#        the end. A chunk that's as big as its uncompressed size is stored.
+
+import struct, sys
+
+MAGIC = 0x4C5A3443
+CHUNK_SIZE = 0x4000
+
+MIN_MATCH = 4
+# The format requires the last 5 bytes to be literals, and no match to start
+# in the last 12
+LAST_LITERALS = 5
+MF_LIMIT = 12
+MAX_OFFSET = 0xFFFF
+
+
+def write_length(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def write_sequence(out, literals, match_len, offset):
+    lit_len = len(literals)
+    token = min(lit_len, 15) << 4
+    if match_len != 0:
+        token |= min(match_len - MIN_MATCH, 15)
+    out.append(token)
+    if lit_len >= 15:
+        write_length(out, lit_len - 15)
+    out += literals
+    if match_len != 0:
+        out += struct.pack("<H", offset)
+        if match_len - MIN_MATCH >= 15:
+            write_length(out, match_len - MIN_MATCH - 15)
+
+
+def compress_block(data):
+    out = bytearray()
+    end = len(data)
+    match_limit = end - LAST_LITERALS
+    table = {}
+    anchor = 0
+    pos = 0
+
+    while pos + MF_LIMIT <= end:
+        key = data[pos:pos + MIN_MATCH]
+        candidate = table.get(key)
+        table[key] = pos
+
+        if candidate is None or pos - candidate > MAX_OFFSET:
+            pos += 1
+            continue
+
+        length = MIN_MATCH
+        while (pos + length < match_limit and
+               data[candidate + length] == data[pos + length]):
+            length += 1
+
+        # Extend backwards into the pending literals
+        while (pos > anchor and candidate > 0 and
+               data[pos - 1] == data[candidate - 1]):
+            pos -= 1
+            candidate -= 1
+            length += 1
+
+        write_sequence(out, data[anchor:pos], length, pos - candidate)
+        pos += length
+        anchor = pos
+
+        # Index a position inside the match too, it often repeats
+        if pos - 2 > 0:
+            table[data[pos - 2:pos + 2]] = pos - 2
+
+    write_sequence(out, data[anchor:], 0, 0)
+    return bytes(out)
+
+
+data = open(sys.argv[1], "rb").read()
+
+chunks = []
+for start in range(0, len(data), CHUNK_SIZE):
+    chunk = data[start:start + CHUNK_SIZE]
+    block = compress_block(chunk)
+    chunks.append(block if len(block) < len(chunk) else chunk)
+
+header = struct.pack(">IIII", MAGIC, len(data), CHUNK_SIZE, len(chunks))
+header += data[:16].ljust(16, b"\0")
+
+offset = len(header) + 4 * (len(chunks) + 1)
+offsets = []
+for chunk in chunks:
+    offsets.append(offset)
+    offset += len(chunk)
+offsets.append(offset)
+
+with open(sys.argv[2], "wb") as out:
+    out.write(header)
+    out.write(struct.pack(">%dI" % len(offsets), *offsets))
+    for chunk in chunks:
+        out.write(chunk)
+
+print("%s: %d -> %d bytes (%.1f%%)" % (sys.argv[1], len(data), offset,
+                                        offset * 100.0 / max(len(data), 1)))
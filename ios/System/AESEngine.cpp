@@ -0,0 +1,182 @@
+// AESEngine.cpp - Direct Hollywood AES engine driver
+//
+// SPDX-License-Identifier: MIT
+
+#include "AESEngine.hpp"
+#include <Debug/Log.hpp>
+#include <IOS/Syscalls.h>
+#include <IOS/System.hpp>
+#include <System/Hollywood.hpp>
+#include <System/OS.hpp>
+#include <System/Util.h>
+#include <algorithm>
+#include <cstring>
+
+namespace AESEngine
+{
+
+static constexpr u32 BlockSize = 16;
+// The block count field is 12 bits
+static constexpr u32 MaxCommandSize = 0x1000 * BlockSize;
+static constexpr u32 CacheLineSize = 32;
+
+// 100 ms in Hollywood timer ticks, far longer than any single command
+static constexpr u32 CommandTimeout = 243000000 / 128 / 10;
+
+static Mutex s_lock;
+
+static u32 ReadReg(AESReg reg)
+{
+    return read32(AES_BASE + static_cast<u32>(reg));
+}
+
+static void WriteReg(AESReg reg, u32 value)
+{
+    write32(AES_BASE + static_cast<u32>(reg), value);
+}
+
+static u32 PhysicalAddress(const void* ptr)
+{
+    return u32(uintptr_t(IOS_VirtualToPhysical(const_cast<void*>(ptr))));
+}
+
+static void WriteFIFO(AESReg reg, const u8* data)
+{
+    for (u32 i = 0; i < BlockSize; i += 4) {
+        u32 word;
+        memcpy(&word, data + i, 4);
+        WriteReg(reg, word);
+    }
+}
+
+/*
+ * Poll for completion, with interrupts masked. The engine interrupt belongs to
+ * the IOSC kernel code, so it can't be used here.
+ */
+static s32 Wait()
+{
+    const u32 start = ACRReadTrusted(ACRReg::TIMER);
+
+    while (true) {
+        const u32 ctrl = ReadReg(AESReg::CTRL);
+        if (ctrl & u32(AESCtrlBit::ERR))
+            return IOSError::Invalid;
+        if (!(ctrl & u32(AESCtrlBit::EXEC)))
+            return IOSError::OK;
+
+        if (ACRReadTrusted(ACRReg::TIMER) - start > CommandTimeout)
+            return IOSError::Invalid;
+    }
+}
+
+/*
+ * Mask interrupts with the engine free for a command of ours. IOSC programs
+ * the engine and reads back its results from the kernel, which can't run
+ * until the interrupts are restored. A command it has running, or one whose
+ * interrupt is still pending, has to be waited out with them enabled.
+ */
+static s32 Acquire(bool wait, u32* cpsr)
+{
+    const u32 start = ACRReadTrusted(ACRReg::TIMER);
+
+    while (true) {
+        *cpsr = IRQDisable();
+        if (!(ReadReg(AESReg::CTRL) & u32(AESCtrlBit::EXEC)) &&
+            !(ACRReadTrusted(ACRReg::ARM_IRQFLAG) & u32(ACRIRQBit::AES)))
+            return IOSError::OK;
+        IRQRestore(*cpsr);
+
+        if (!wait)
+            return IOSError::NoAccess;
+
+        if (ACRReadTrusted(ACRReg::TIMER) - start > CommandTimeout)
+            return IOSError::Invalid;
+    }
+}
+
+s32 Crypt(bool decrypt, const u8* key, u8* iv, const void* input, u32 size,
+          void* output)
+{
+    // DMA works on whole blocks from 16 byte aligned addresses. The output is
+    // invalidated from the cache afterwards, so it must be whole cache lines.
+    if (size == 0 || size % CacheLineSize != 0 ||
+        !aligned(input, BlockSize) || !aligned(output, CacheLineSize))
+        return IOSError::NoAccess;
+
+    if (!(ACRReadTrusted(ACRReg::BUSPROT) & u32(ACRBUSPROTBit::IOPAESEN)))
+        return IOSError::NoAccess;
+
+    // IOSC is only kept off the engine with interrupts masked
+    if (!IRQMaskable())
+        return IOSError::NoAccess;
+
+    const u8* in = reinterpret_cast<const u8*>(input);
+    u8* out = reinterpret_cast<u8*>(output);
+
+    u8 chainIv[BlockSize];
+    memcpy(chainIv, iv, BlockSize);
+
+    IOS_FlushDCache(input, size);
+    IOS_FlushDCache(output, size);
+
+    const u32 mode = u32(AESCtrlBit::EXEC) | u32(AESCtrlBit::ENA) |
+                     (decrypt ? u32(AESCtrlBit::DEC) : 0);
+
+    s_lock.lock();
+
+    s32 ret = IOSError::OK;
+    for (u32 pos = 0; pos < size; pos += MaxCommandSize) {
+        const u32 len = std::min(size - pos, MaxCommandSize);
+        const u32 last = pos + len - BlockSize;
+        const u32 src = PhysicalAddress(in + pos);
+        const u32 dest = PhysicalAddress(out + pos);
+
+        // Decrypting in place overwrites the block that chains to the next
+        u8 nextIv[BlockSize];
+        memcpy(nextIv, in + last, BlockSize);
+
+        /*
+         * Leave the engine to IOSC if it's busy before anything was done,
+         * /dev/aes queues behind it instead. IOSC may have used the engine
+         * between two commands, so the key and IV are loaded for each.
+         */
+        u32 cpsr;
+        ret = Acquire(pos != 0, &cpsr);
+        if (ret != IOSError::OK) {
+            if (pos != 0) {
+                PRINT(IOS, ERROR, "AES engine stayed busy at 0x%X", pos);
+            }
+            break;
+        }
+
+        WriteReg(AESReg::CTRL, 0);
+        WriteFIFO(AESReg::KEY, key);
+        WriteFIFO(AESReg::IV, chainIv);
+        WriteReg(AESReg::SRC, src);
+        WriteReg(AESReg::DEST, dest);
+        WriteReg(AESReg::CTRL, mode | (len / BlockSize - 1));
+
+        ret = Wait();
+        if (ret != IOSError::OK)
+            WriteReg(AESReg::CTRL, 0);
+
+        IRQRestore(cpsr);
+
+        if (ret != IOSError::OK) {
+            PRINT(IOS, ERROR, "AES engine command failed at 0x%X", pos);
+            break;
+        }
+
+        IOS_InvalidateDCache(out + pos, len);
+        memcpy(chainIv, decrypt ? nextIv : out + last, BlockSize);
+    }
+
+    s_lock.unlock();
+
+    if (ret == IOSError::OK)
+        memcpy(iv, chainIv, BlockSize);
+
+    return ret;
+}
+
+} // namespace AESEngine
@@ -0,0 +1,22 @@
+// AESEngine.hpp - Direct Hollywood AES engine driver
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <System/Types.h>
+
+namespace AESEngine
+{
+
+/*
+ * AES-128 CBC encrypt or decrypt using the engine registers, without going
+ * through /dev/aes. The IV is updated to continue the chain like the IOSC
+ * ioctl does. Returns IOSError::NoAccess without touching anything if the
+ * engine can't be used for this request, so the caller can fall back to
+ * /dev/aes.
+ */
+s32 Crypt(bool decrypt, const u8* key, u8* iv, const void* input, u32 size,
+          void* output);
+
+} // namespace AESEngine
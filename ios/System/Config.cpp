@@ -30,3 +30,8 @@ bool Config::BlockIOSReload()
     return m_blockIOSReload;
     // return false;
 }
+
+bool Config::IsStorageBenchEnabled()
+{
+    return m_storageBench;
+}
@@ -15,6 +15,13 @@ public:
     bool IsISFSPathReplaced(const char* path);
     bool IsFileLogEnabled();
     bool BlockIOSReload();
+    bool IsStorageBenchEnabled();
 
     bool m_blockIOSReload = false;
+#if defined(STORAGE_BENCH) && !defined(TARGET_HOST)
+    // Building with make STORAGE_BENCH=1 is how the benchmark is asked for
+    bool m_storageBench = true;
+#else
+    bool m_storageBench = false;
+#endif
 };
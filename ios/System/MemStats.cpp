@@ -0,0 +1,243 @@
+// MemStats.cpp - IOS heap and stack usage accounting
+//
+// SPDX-License-Identifier: MIT
+
+#include "MemStats.hpp"
+#include <Disk/DeviceMgr.hpp>
+#include <IOS/Syscalls.h>
+#include <System/OS.hpp>
+#include <System/Slab.hpp>
+#include <System/Util.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdarg.h>
+
+namespace MemStats
+{
+
+static constexpr u32 StackPaint = 0x5A0157AC;
+
+struct Site {
+    u32 tag;
+    u32 current;
+    u32 peak;
+    u32 count;
+};
+
+struct Stack {
+    s32 threadId;
+    u32* base;
+    u32 size;
+};
+
+static u32 s_heapSize;
+static u32 s_heapCurrent;
+static u32 s_heapPeak;
+static u32 s_heapCount;
+
+// Site 0 is the overflow bucket
+static Site s_sites[Log::MemReport::MaxSites];
+static u32 s_siteCount = 1;
+
+static Stack s_stacks[Log::MemReport::MaxStacks];
+static u32 s_stackCount;
+
+// Allocations before Init are not locked
+static Mutex* s_lock;
+
+static void Lock()
+{
+    if (s_lock != nullptr)
+        s_lock->lock();
+}
+
+static void Unlock()
+{
+    if (s_lock != nullptr)
+        s_lock->unlock();
+}
+
+void Init(u32 heapSize)
+{
+    s_heapSize = heapSize;
+
+    s_lock = new Mutex;
+}
+
+/*
+ * Account an allocation from the system heap. Returns the site index to pass
+ * to OnFree. Only called in HEAP_STATS builds, as it needs a header on every
+ * block.
+ */
+u16 OnAlloc(u32 tag, u32 size)
+{
+    Lock();
+
+    u32 site = 0;
+    for (u32 i = 1; i < s_siteCount; i++) {
+        if (s_sites[i].tag == tag) {
+            site = i;
+            break;
+        }
+    }
+
+    if (site == 0 && s_siteCount < Log::MemReport::MaxSites) {
+        site = s_siteCount++;
+        s_sites[site].tag = tag;
+    }
+
+    Site& entry = s_sites[site];
+    entry.current += size;
+    entry.count++;
+    if (entry.current > entry.peak)
+        entry.peak = entry.current;
+
+    s_heapCurrent += size;
+    s_heapCount++;
+    if (s_heapCurrent > s_heapPeak)
+        s_heapPeak = s_heapCurrent;
+
+    Unlock();
+    return site;
+}
+
+void OnFree(u16 site, u32 size)
+{
+    Lock();
+    s_sites[site].current -= size;
+    s_heapCurrent -= size;
+    Unlock();
+}
+
+/*
+ * Fill a thread stack with a known pattern before the thread starts, so the
+ * high watermark can be found later.
+ */
+void PaintStack(u8* stack, u32 size)
+{
+    u32* words = reinterpret_cast<u32*>(stack);
+    for (u32 i = 0; i < size / 4; i++)
+        words[i] = StackPaint;
+}
+
+void RegisterStack(s32 threadId, u8* stack, u32 size)
+{
+    Lock();
+    if (s_stackCount < Log::MemReport::MaxStacks) {
+        s_stacks[s_stackCount++] = {
+            .threadId = threadId,
+            .base = reinterpret_cast<u32*>(stack),
+            .size = size,
+        };
+    }
+    Unlock();
+}
+
+/*
+ * The stack grows down, so count the untouched words from the bottom.
+ */
+static u32 ScanStack(const Stack& stack)
+{
+    u32 unused = 0;
+    while (unused < stack.size / 4 && stack.base[unused] == StackPaint)
+        unused++;
+
+    return stack.size - unused * 4;
+}
+
+void GetReport(Log::MemReport* report)
+{
+    memset(report, 0, sizeof(Log::MemReport));
+
+    Lock();
+    report->heapSize = s_heapSize;
+    report->heapCurrent = s_heapCurrent;
+    report->heapPeak = s_heapPeak;
+    report->heapCount = s_heapCount;
+
+    report->siteCount = s_siteCount;
+    for (u32 i = 0; i < s_siteCount; i++) {
+        report->sites[i] = {
+            .tag = s_sites[i].tag,
+            .current = s_sites[i].current,
+            .peak = s_sites[i].peak,
+            .count = s_sites[i].count,
+        };
+    }
+
+    report->stackCount = s_stackCount;
+    for (u32 i = 0; i < s_stackCount; i++) {
+        report->stacks[i] = {
+            .threadId = s_stacks[i].threadId,
+            .size = s_stacks[i].size,
+            .used = ScanStack(s_stacks[i]),
+            .pad = 0,
+        };
+    }
+    Unlock();
+
+    report->slabCount =
+        std::min<u32>(Slab::GetClassCount(), Log::MemReport::MaxSlabs);
+    for (u32 i = 0; i < report->slabCount; i++) {
+        Slab::Stats stats = Slab::GetStats(i);
+        report->slabs[i] = {
+            .blockSize = stats.blockSize,
+            .blockCount = stats.blockCount,
+            .peak = stats.peak,
+            .fallbackCount = stats.fallbackCount,
+        };
+    }
+}
+
+static void WriteLine(const char* format, ...)
+{
+    char line[96];
+
+    va_list args;
+    va_start(args, format);
+    u32 len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    len = std::min<u32>(len, sizeof(line) - 1);
+    DeviceMgr::sInstance->WriteToLog(line, len);
+}
+
+/*
+ * Write the report to log.txt, called before the game starts.
+ */
+void WriteToLog()
+{
+    if (DeviceMgr::sInstance == nullptr ||
+        !DeviceMgr::sInstance->IsLogEnabled())
+        return;
+
+    static Log::MemReport report;
+    GetReport(&report);
+
+#ifdef HEAP_STATS
+    WriteLine("[Mem] heap: peak %u/%u, current %u, %u allocs",
+              report.heapPeak, report.heapSize, report.heapCurrent,
+              report.heapCount);
+
+    for (u32 i = 0; i < report.siteCount; i++) {
+        const auto& site = report.sites[i];
+        WriteLine("[Mem] site %08X: peak %u, current %u, %u allocs", site.tag,
+                  site.peak, site.current, site.count);
+    }
+#endif
+
+    for (u32 i = 0; i < report.stackCount; i++) {
+        const auto& stack = report.stacks[i];
+        WriteLine("[Mem] thread %d stack: %u/%u", stack.threadId, stack.used,
+                  stack.size);
+    }
+
+    for (u32 i = 0; i < report.slabCount; i++) {
+        const auto& slab = report.slabs[i];
+        WriteLine("[Mem] slab 0x%X: peak %u/%u, %u fallbacks", slab.blockSize,
+                  slab.peak, slab.blockCount, slab.fallbackCount);
+    }
+}
+
+} // namespace MemStats
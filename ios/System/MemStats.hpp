@@ -0,0 +1,29 @@
+// MemStats.hpp - IOS heap and stack usage accounting
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Debug/MemReport.hpp>
+#include <System/Types.h>
+
+/*
+ * Heap accounting needs a header on every system heap block, so OnAlloc and
+ * OnFree are only used by a HEAP_STATS build. Stacks and slabs are always
+ * reported.
+ */
+namespace MemStats
+{
+
+void Init(u32 heapSize);
+
+u16 OnAlloc(u32 tag, u32 size);
+void OnFree(u16 site, u32 size);
+
+void PaintStack(u8* stack, u32 size);
+void RegisterStack(s32 threadId, u8* stack, u32 size);
+
+void GetReport(Log::MemReport* report);
+void WriteToLog();
+
+} // namespace MemStats
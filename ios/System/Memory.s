@@ -0,0 +1,155 @@
+// Memory.s - memcpy and memset for the ARM926
+//
+// SPDX-License-Identifier: MIT
+
+// These replace the size optimized newlib versions. Bulk data moves in 32
+// byte LDM/STM bursts, one cache line at a time, with the destination line
+// aligned first so the write buffer can merge each burst. The ARM926 has no
+// working PLD, so the copy loop reads the next half line ahead of the store
+// instead.
+
+    .syntax unified
+    .section ".text.memcpy", "ax", %progbits
+    .arm
+    .align  2
+
+    .global memcpy
+    .type   memcpy, %function
+memcpy:
+    // r0 = dst, r1 = src, r2 = len
+    push    {r0, r4-r9, lr}
+    cmp     r2, #16
+    blt     .Lmemcpy_bytes
+
+    // Fast path for whole sectors between cache line aligned buffers
+    orr     r3, r0, r1
+    and     r3, r3, #31
+    orrs    r3, r3, r2, lsl #23
+    beq     .Lmemcpy_sectors
+
+    // Words can only be used if both sides can be aligned together
+    eor     r3, r0, r1
+    tst     r3, #3
+    bne     .Lmemcpy_bytes
+
+.Lmemcpy_align:
+    tst     r0, #3
+    beq     .Lmemcpy_line
+    ldrb    r3, [r1], #1
+    strb    r3, [r0], #1
+    sub     r2, r2, #1
+    b       .Lmemcpy_align
+
+.Lmemcpy_line:
+    tst     r0, #31
+    beq     .Lmemcpy_blocks
+    cmp     r2, #4
+    blt     .Lmemcpy_bytes
+    ldr     r3, [r1], #4
+    str     r3, [r0], #4
+    sub     r2, r2, #4
+    b       .Lmemcpy_line
+
+.Lmemcpy_blocks:
+    subs    r2, r2, #32
+    blt     .Lmemcpy_words
+    ldmia   r1!, {r3-r6}
+.Lmemcpy_block_loop:
+    ldmia   r1!, {r7-r9, ip}
+    stmia   r0!, {r3-r6}
+    subs    r2, r2, #32
+    // Read the first half of the next line before finishing this one
+    ldmiage r1!, {r3-r6}
+    stmia   r0!, {r7-r9, ip}
+    bge     .Lmemcpy_block_loop
+
+.Lmemcpy_words:
+    add     r2, r2, #32
+.Lmemcpy_word_loop:
+    cmp     r2, #4
+    blt     .Lmemcpy_bytes
+    ldr     r3, [r1], #4
+    str     r3, [r0], #4
+    sub     r2, r2, #4
+    b       .Lmemcpy_word_loop
+
+.Lmemcpy_bytes:
+    subs    r2, r2, #1
+    ldrbge  r3, [r1], #1
+    strbge  r3, [r0], #1
+    bgt     .Lmemcpy_bytes
+    pop     {r0, r4-r9, pc}
+
+.Lmemcpy_sectors:
+    // len is a non-zero multiple of 512
+    ldmia   r1!, {r3-r9, ip}
+    stmia   r0!, {r3-r9, ip}
+    ldmia   r1!, {r3-r9, ip}
+    stmia   r0!, {r3-r9, ip}
+    subs    r2, r2, #64
+    bne     .Lmemcpy_sectors
+    pop     {r0, r4-r9, pc}
+    .size   memcpy, . - memcpy
+
+    .section ".text.memset", "ax", %progbits
+    .arm
+    .align  2
+
+    .global memset
+    .type   memset, %function
+memset:
+    // r0 = dst, r1 = value, r2 = len
+    push    {r0, r4-r9, lr}
+    and     r1, r1, #0xFF
+    orr     r1, r1, r1, lsl #8
+    orr     r1, r1, r1, lsl #16
+    cmp     r2, #16
+    blt     .Lmemset_bytes
+
+.Lmemset_align:
+    tst     r0, #3
+    beq     .Lmemset_line
+    strb    r1, [r0], #1
+    sub     r2, r2, #1
+    b       .Lmemset_align
+
+.Lmemset_line:
+    tst     r0, #31
+    beq     .Lmemset_blocks
+    cmp     r2, #4
+    blt     .Lmemset_bytes
+    str     r1, [r0], #4
+    sub     r2, r2, #4
+    b       .Lmemset_line
+
+.Lmemset_blocks:
+    mov     r3, r1
+    mov     r4, r1
+    mov     r5, r1
+    mov     r6, r1
+    mov     r7, r1
+    mov     r8, r1
+    mov     r9, r1
+    mov     ip, r1
+    subs    r2, r2, #32
+    blt     .Lmemset_words
+.Lmemset_block_loop:
+    stmia   r0!, {r3-r9, ip}
+    subs    r2, r2, #32
+    bge     .Lmemset_block_loop
+
+.Lmemset_words:
+    add     r2, r2, #32
+.Lmemset_word_loop:
+    cmp     r2, #4
+    blt     .Lmemset_bytes
+    str     r1, [r0], #4
+    sub     r2, r2, #4
+    b       .Lmemset_word_loop
+
+.Lmemset_bytes:
+    subs    r2, r2, #1
+    strbge  r1, [r0], #1
+    bgt     .Lmemset_bytes
+    pop     {r0, r4-r9, pc}
+    .size   memset, . - memset
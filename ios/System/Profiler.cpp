@@ -0,0 +1,229 @@
+// Profiler.cpp - Sampling profiler for the IOS module's threads
+//
+// SPDX-License-Identifier: MIT
+
+#ifdef PROFILER
+
+#include "Profiler.hpp"
+#include "MemStats.hpp"
+#include <Debug/Log.hpp>
+#include <Disk/DeviceMgr.hpp>
+#include <IOS/Syscalls.h>
+#include <IOS/System.hpp>
+#include <System/Util.h>
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <stdarg.h>
+
+namespace Profiler
+{
+
+constexpr u32 IntervalUsec = 1000;
+// Above TimerMgr, so it can sample that too. IOS won't create a thread above
+// the caller's priority, so Start has to run before the main thread drops.
+constexpr u32 Priority = 125;
+
+constexpr u32 BucketCount = 1024;
+// Most frequent buckets written to the log
+constexpr u32 ReportCount = 256;
+
+// Kernel thread table, see IOSBoot::DebugLaunchReport on the PPC
+constexpr u32 ThreadTable = 0xFFFE0000;
+constexpr u32 ThreadSize = 0xB0;
+constexpr u32 MaxThreads = 100;
+
+constexpr u32 ContextPC = 0x40;
+constexpr u32 ContextState = 0x50;
+constexpr u32 ContextPID = 0x54;
+
+enum class ThreadState : u32 {
+    Free = 0,
+    Ready = 1,
+    Running = 2,
+    Stopped = 3,
+    Waiting = 4,
+    Dead = 5,
+};
+
+struct Bucket {
+    u32 pc;
+    u32 count;
+};
+
+struct ThreadStats {
+    u32 runnable;
+    u32 waiting;
+};
+
+static u32 s_queueData[4];
+static s32 s_queue;
+static s32 s_timer = -1;
+static s32 s_selfId;
+static s32 s_pid;
+static bool s_stopped;
+
+static u32 s_sampleCount;
+static u32 s_droppedCount;
+static Bucket s_buckets[BucketCount];
+static ThreadStats s_threads[MaxThreads];
+
+static void Record(u32 pc)
+{
+    // Fibonacci hash of the word address
+    u32 index = ((pc >> 2) * 2654435761u) % BucketCount;
+
+    for (u32 i = 0; i < BucketCount; i++) {
+        Bucket& bucket = s_buckets[index];
+        if (bucket.count == 0)
+            bucket.pc = pc;
+
+        if (bucket.pc == pc) {
+            bucket.count++;
+            return;
+        }
+
+        index = (index + 1) % BucketCount;
+    }
+
+    s_droppedCount++;
+}
+
+/*
+ * Every other thread is switched out while this one runs, so their saved
+ * contexts are current.
+ */
+static void Sample()
+{
+    s_sampleCount++;
+
+    for (u32 id = 0; id < MaxThreads; id++) {
+        if (s32(id) == s_selfId)
+            continue;
+
+        const u32 thread = ThreadTable + id * ThreadSize;
+        if (read32(thread) == 0 || s32(read32(thread + ContextPID)) != s_pid)
+            continue;
+
+        switch (ThreadState(read32(thread + ContextState))) {
+        case ThreadState::Ready:
+        case ThreadState::Running:
+            s_threads[id].runnable++;
+            Record(read32(thread + ContextPC) & ~1);
+            break;
+
+        case ThreadState::Waiting:
+            s_threads[id].waiting++;
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+static s32 ThreadEntry([[maybe_unused]] void* arg)
+{
+    while (true) {
+        u32 msg;
+        if (IOS_ReceiveMessage(s_queue, &msg, 0) < 0)
+            break;
+
+        if (s_stopped)
+            break;
+
+        Sample();
+    }
+
+    return 0;
+}
+
+void Start()
+{
+    s_queue = IOS_CreateMessageQueue(s_queueData, std::size(s_queueData));
+    if (s_queue < 0) {
+        PRINT(IOS, ERROR, "Profiler: Failed to create message queue: %d",
+              s_queue);
+        return;
+    }
+
+    s_pid = IOS_GetProcessId();
+
+    static u8 Stack[0x400] ATTRIBUTE_ALIGN(32);
+    MemStats::PaintStack(Stack, sizeof(Stack));
+
+    s_selfId = IOS_CreateThread(
+        ThreadEntry, nullptr, reinterpret_cast<u32*>(Stack + sizeof(Stack)),
+        sizeof(Stack), Priority, true);
+    if (s_selfId < 0) {
+        PRINT(IOS, ERROR, "Profiler: Failed to create thread: %d", s_selfId);
+        return;
+    }
+    MemStats::RegisterStack(s_selfId, Stack, sizeof(Stack));
+
+    // System mode, so it can read the thread table
+    u32 cpsr = 0x1F | ((u32)(ThreadEntry)&1 ? 0x20 : 0);
+    KernelWrite(ThreadTable + s_selfId * ThreadSize, cpsr);
+
+    s32 ret = IOS_StartThread(s_selfId);
+    if (ret < 0) {
+        PRINT(IOS, ERROR, "Profiler: Failed to start thread: %d", ret);
+        return;
+    }
+
+    s_timer = IOS_CreateTimer(IntervalUsec, IntervalUsec, s_queue, 0);
+    if (s_timer < 0) {
+        PRINT(IOS, ERROR, "Profiler: Failed to create timer: %d", s_timer);
+    }
+}
+
+static void WriteLine(const char* format, ...)
+{
+    char line[96];
+
+    va_list args;
+    va_start(args, format);
+    u32 len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    len = std::min<u32>(len, sizeof(line) - 1);
+    DeviceMgr::sInstance->WriteToLog(line, len);
+}
+
+/*
+ * Stop sampling and write the histogram to log.txt, most frequent first.
+ */
+void WriteToLog()
+{
+    s_stopped = true;
+    if (s_timer >= 0) {
+        IOS_DestroyTimer(s_timer);
+        s_timer = -1;
+    }
+
+    if (DeviceMgr::sInstance == nullptr ||
+        !DeviceMgr::sInstance->IsLogEnabled())
+        return;
+
+    std::sort(std::begin(s_buckets), std::end(s_buckets),
+              [](const Bucket& a, const Bucket& b) {
+                  return a.count > b.count;
+              });
+
+    WriteLine("[Prof] %u samples every %u us, %u dropped", s_sampleCount,
+              IntervalUsec, s_droppedCount);
+
+    for (u32 id = 0; id < MaxThreads; id++) {
+        const ThreadStats& stats = s_threads[id];
+        if (stats.runnable != 0 || stats.waiting != 0)
+            WriteLine("[Prof] thread %u: %u runnable, %u waiting", id,
+                      stats.runnable, stats.waiting);
+    }
+
+    for (u32 i = 0; i < ReportCount && s_buckets[i].count != 0; i++)
+        WriteLine("[Prof] pc %08X %u", s_buckets[i].pc, s_buckets[i].count);
+}
+
+} // namespace Profiler
+
+#endif
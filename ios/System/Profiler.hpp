@@ -0,0 +1,40 @@
+// Profiler.hpp - Sampling profiler for the IOS module's threads
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <System/Types.h>
+
+/*
+ * Periodically samples the saved context of each of our process's threads
+ * from the kernel thread table, the same one IOSBoot::DebugLaunchReport reads
+ * from the PPC, and counts the PC of every thread that was runnable into a
+ * histogram. Only built with PROFILER defined (make PROFILER=1), otherwise
+ * the hooks compile to nothing.
+ *
+ * The histogram is written to log.txt before the game starts, as lines of
+ * "[Prof] pc <address> <count>". symbolize_profile.py in this directory
+ * resolves them against saoirse_ios_dbg.elf.
+ */
+namespace Profiler
+{
+
+#ifdef PROFILER
+
+void Start();
+void WriteToLog();
+
+#else
+
+static inline void Start()
+{
+}
+
+static inline void WriteToLog()
+{
+}
+
+#endif
+
+} // namespace Profiler
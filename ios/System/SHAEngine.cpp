@@ -0,0 +1,279 @@
+// SHAEngine.cpp - Direct Hollywood SHA-1 engine driver
+//
+// SPDX-License-Identifier: MIT
+
+#include "SHAEngine.hpp"
+#include <Debug/Log.hpp>
+#include <IOS/Syscalls.h>
+#include <IOS/System.hpp>
+#include <System/Hollywood.hpp>
+#include <System/OS.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace SHAEngine
+{
+
+// The block count field is 10 bits
+static constexpr u32 MaxCommandSize = 0x400 * BlockSize;
+
+// 100 ms in Hollywood timer ticks, far longer than any single command
+static constexpr u32 CommandTimeout = 243000000 / 128 / 10;
+
+// Unaligned input is hashed through this buffer
+static constexpr u32 BounceSize = 0x1000;
+static u8 s_bounce[BounceSize] ATTRIBUTE_ALIGN(64);
+
+static Mutex s_lock;
+
+static u32 ReadReg(SHAReg reg)
+{
+    return read32(SHA_BASE + static_cast<u32>(reg));
+}
+
+static void WriteReg(SHAReg reg, u32 value)
+{
+    write32(SHA_BASE + static_cast<u32>(reg), value);
+}
+
+static SHAReg HReg(u32 i)
+{
+    return static_cast<SHAReg>(u32(SHAReg::H0) + i * 4);
+}
+
+static u32 PhysicalAddress(const void* ptr)
+{
+    return u32(uintptr_t(IOS_VirtualToPhysical(const_cast<void*>(ptr))));
+}
+
+/*
+ * Mask interrupts once IOSC has no command running or interrupt pending on
+ * the engine. The kernel can't touch it again until IRQRestore.
+ */
+static s32 Acquire(u32* cpsr)
+{
+    const u32 start = ACRReadTrusted(ACRReg::TIMER);
+
+    while (true) {
+        *cpsr = IRQDisable();
+        if (!(ReadReg(SHAReg::CTRL) & u32(SHACtrlBit::EXEC)) &&
+            !(ACRReadTrusted(ACRReg::ARM_IRQFLAG) & u32(ACRIRQBit::SHA)))
+            return IOSError::OK;
+        IRQRestore(*cpsr);
+
+        if (ACRReadTrusted(ACRReg::TIMER) - start > CommandTimeout)
+            return IOSError::Invalid;
+    }
+}
+
+/*
+ * Poll for completion, with interrupts masked. The engine interrupt belongs
+ * to IOSC, so polling is the only option.
+ */
+static s32 Wait()
+{
+    const u32 start = ACRReadTrusted(ACRReg::TIMER);
+
+    while (true) {
+        const u32 ctrl = ReadReg(SHAReg::CTRL);
+        if (ctrl & u32(SHACtrlBit::ERR))
+            return IOSError::Invalid;
+        if (!(ctrl & u32(SHACtrlBit::EXEC)))
+            return IOSError::OK;
+
+        if (ACRReadTrusted(ACRReg::TIMER) - start > CommandTimeout)
+            return IOSError::Invalid;
+    }
+}
+
+/*
+ * Hash one command's worth of whole blocks from the context state. The data
+ * must be flushed from the cache.
+ *
+ * IOSC may not have read back the state of its last command yet, it does
+ * that some time after the interrupt was handled. Its registers are put back
+ * the way they were found.
+ */
+static s32 Command(Context* ctx, const u8* data, u32 len)
+{
+    const u32 src = PhysicalAddress(data);
+
+    u32 cpsr;
+    s32 ret = Acquire(&cpsr);
+    if (ret != IOSError::OK) {
+        PRINT(IOS, ERROR, "SHA engine stayed busy");
+        return ret;
+    }
+
+    u32 saved[6];
+    saved[0] = ReadReg(SHAReg::SRC);
+    for (u32 i = 0; i < 5; i++)
+        saved[i + 1] = ReadReg(HReg(i));
+
+    WriteReg(SHAReg::CTRL, 0);
+    for (u32 i = 0; i < 5; i++)
+        WriteReg(HReg(i), ctx->state[i]);
+    WriteReg(SHAReg::SRC, src);
+    WriteReg(SHAReg::CTRL, u32(SHACtrlBit::EXEC) | (len / BlockSize - 1));
+
+    ret = Wait();
+    if (ret == IOSError::OK) {
+        for (u32 i = 0; i < 5; i++)
+            ctx->state[i] = ReadReg(HReg(i));
+    }
+
+    WriteReg(SHAReg::CTRL, 0);
+    WriteReg(SHAReg::SRC, saved[0]);
+    for (u32 i = 0; i < 5; i++)
+        WriteReg(HReg(i), saved[i + 1]);
+
+    IRQRestore(cpsr);
+
+    if (ret != IOSError::OK) {
+        PRINT(IOS, ERROR, "SHA engine command failed");
+    }
+    return ret;
+}
+
+/*
+ * Hash whole blocks. Lock must be held.
+ */
+static s32 RunLocked(Context* ctx, const u8* data, u32 len)
+{
+    IOS_FlushDCache(data, len);
+
+    s32 ret = IOSError::OK;
+    for (u32 pos = 0; pos < len && ret == IOSError::OK;
+         pos += MaxCommandSize)
+        ret = Command(ctx, data + pos, std::min(len - pos, MaxCommandSize));
+
+    return ret;
+}
+
+static s32 Run(Context* ctx, const u8* data, u32 len)
+{
+    s_lock.lock();
+    const s32 ret = RunLocked(ctx, data, len);
+    s_lock.unlock();
+
+    return ret;
+}
+
+/*
+ * Returns IOSError::NoAccess if IOP access to the engine is disabled, or if
+ * IOSC can't be kept off it from this thread, in which case /dev/sha has to be
+ * used instead.
+ */
+s32 Init(Context* ctx)
+{
+    if (!(ACRReadTrusted(ACRReg::BUSPROT) & u32(ACRBUSPROTBit::IOPSHAEN)))
+        return IOSError::NoAccess;
+
+    // IOSC is only kept off the engine with interrupts masked
+    if (!IRQMaskable())
+        return IOSError::NoAccess;
+
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xEFCDAB89;
+    ctx->state[2] = 0x98BADCFE;
+    ctx->state[3] = 0x10325476;
+    ctx->state[4] = 0xC3D2E1F0;
+    ctx->length = 0;
+    ctx->bufferLen = 0;
+    return IOSError::OK;
+}
+
+/*
+ * Whole blocks at a 64 byte aligned address are read straight from data,
+ * anything else is copied through a buffer.
+ */
+s32 Update(Context* ctx, const void* data, u32 len)
+{
+    s32 ret = IOSError::OK;
+    const u8* in = reinterpret_cast<const u8*>(data);
+    ctx->length += len;
+
+    if (ctx->bufferLen != 0) {
+        const u32 fill = std::min(len, BlockSize - ctx->bufferLen);
+        memcpy(ctx->buffer + ctx->bufferLen, in, fill);
+        ctx->bufferLen += fill;
+        in += fill;
+        len -= fill;
+
+        if (ctx->bufferLen < BlockSize)
+            return IOSError::OK;
+
+        ctx->bufferLen = 0;
+        ret = Run(ctx, ctx->buffer, BlockSize);
+        if (ret != IOSError::OK)
+            return ret;
+    }
+
+    const u32 whole = round_down(len, BlockSize);
+    const u32 tail = len - whole;
+    memcpy(ctx->buffer, in + whole, tail);
+    ctx->bufferLen = tail;
+
+    if (whole == 0)
+        return IOSError::OK;
+
+    if (!aligned(in, BlockSize)) {
+        for (u32 pos = 0; pos < whole && ret == IOSError::OK;
+             pos += BounceSize) {
+            const u32 size = std::min(whole - pos, BounceSize);
+            s_lock.lock();
+            memcpy(s_bounce, in + pos, size);
+            ret = RunLocked(ctx, s_bounce, size);
+            s_lock.unlock();
+        }
+        return ret;
+    }
+
+    return Run(ctx, in, whole);
+}
+
+s32 Final(Context* ctx, u8* hashOut)
+{
+    s32 ret;
+    ctx->buffer[ctx->bufferLen++] = 0x80;
+    if (ctx->bufferLen > BlockSize - 8) {
+        memset(ctx->buffer + ctx->bufferLen, 0, BlockSize - ctx->bufferLen);
+        ret = Run(ctx, ctx->buffer, BlockSize);
+        if (ret != IOSError::OK)
+            return ret;
+        ctx->bufferLen = 0;
+    }
+
+    memset(ctx->buffer + ctx->bufferLen, 0, BlockSize - 8 - ctx->bufferLen);
+    const u64 bits = ctx->length * 8;
+    for (u32 i = 0; i < 8; i++)
+        ctx->buffer[BlockSize - 1 - i] = u8(bits >> (i * 8));
+
+    ret = Run(ctx, ctx->buffer, BlockSize);
+    if (ret != IOSError::OK)
+        return ret;
+
+    for (u32 i = 0; i < 5; i++) {
+        hashOut[i * 4 + 0] = u8(ctx->state[i] >> 24);
+        hashOut[i * 4 + 1] = u8(ctx->state[i] >> 16);
+        hashOut[i * 4 + 2] = u8(ctx->state[i] >> 8);
+        hashOut[i * 4 + 3] = u8(ctx->state[i]);
+    }
+    return IOSError::OK;
+}
+
+s32 Calculate(const void* data, u32 len, u8* hashOut)
+{
+    Context ctx;
+    s32 ret = Init(&ctx);
+    if (ret != IOSError::OK)
+        return ret;
+
+    ret = Update(&ctx, data, len);
+    if (ret != IOSError::OK)
+        return ret;
+
+    return Final(&ctx, hashOut);
+}
+
+} // namespace SHAEngine
@@ -0,0 +1,32 @@
+// SHAEngine.hpp - Direct Hollywood SHA-1 engine driver
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <System/Types.h>
+#include <System/Util.h>
+
+namespace SHAEngine
+{
+
+static constexpr u32 BlockSize = 64;
+
+struct Context {
+    u32 state[5];
+    // Total bytes passed to Update
+    u64 length;
+
+    // Partial block carried over to the next update
+    u32 bufferLen;
+    u8 buffer[BlockSize] ATTRIBUTE_ALIGN(64);
+};
+
+s32 Init(Context* ctx);
+
+s32 Update(Context* ctx, const void* data, u32 len);
+s32 Final(Context* ctx, u8* hashOut);
+
+s32 Calculate(const void* data, u32 len, u8* hashOut);
+
+} // namespace SHAEngine
@@ -0,0 +1,210 @@
+// Slab.cpp - Fixed size block pools for recurring IOS allocations
+//
+// SPDX-License-Identifier: MIT
+
+#include "Slab.hpp"
+#include <Debug/Log.hpp>
+#include <IOS/Syscalls.h>
+#include <IOS/System.hpp>
+#include <System/MemStats.hpp>
+#include <System/OS.hpp>
+#include <System/Util.h>
+
+namespace Slab
+{
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+struct Pool {
+    constexpr Pool(Heap poolHeap, u32 size, u32 count)
+        : heap(poolHeap), blockSize(size), blockCount(count)
+    {
+    }
+
+    Heap heap;
+    u32 blockSize;
+    u32 blockCount;
+
+    u8* base = nullptr;
+    FreeBlock* freeList = nullptr;
+    u32 inUse = 0;
+    u32 peak = 0;
+    u32 allocCount = 0;
+    u32 fallbackCount = 0;
+};
+
+/*
+ * Size classes, smallest first within each heap. Sizes are multiples of 32 so
+ * every block stays cache line aligned for IPC.
+ */
+static Pool s_pools[] = {
+    // USB ioctl input buffers and other small IPC requests
+    {Heap::IPC, 32, 16},
+    // Mutex objects, including FatFS volume sync objects
+    {Heap::System, 32, 16},
+    // FatFS LFN working buffers and TMD copies
+    {Heap::System, 0x500, 4},
+};
+
+static Mutex* s_lock;
+
+#ifdef HEAP_STATS
+
+/*
+ * System heap blocks from outside the pools carry their MemStats site, the
+ * same as operator new. The header is padded to keep the block aligned.
+ */
+struct FallbackHeader {
+    u32 size;
+    u16 site;
+    u8 pad[32 - 6];
+};
+
+static_assert(sizeof(FallbackHeader) == 32);
+
+#endif
+
+static s32 HeapId(Heap heap)
+{
+    return heap == Heap::IPC ? IOS::ipcHeap : System::GetHeap();
+}
+
+static void* HeapAlloc(u32 size, Heap heap, u32 tag)
+{
+    size = round_up(size, 32);
+#ifdef HEAP_STATS
+    if (heap == Heap::System) {
+        size += sizeof(FallbackHeader);
+        FallbackHeader* header = reinterpret_cast<FallbackHeader*>(
+            IOS_AllocAligned(HeapId(heap), size, 32));
+        if (header == nullptr)
+            return nullptr;
+
+        header->size = size;
+        header->site = MemStats::OnAlloc(tag, size);
+        return header + 1;
+    }
+#endif
+
+    return IOS_AllocAligned(HeapId(heap), size, 32);
+}
+
+static s32 HeapFree(void* ptr, Heap heap)
+{
+#ifdef HEAP_STATS
+    if (heap == Heap::System) {
+        FallbackHeader* header = reinterpret_cast<FallbackHeader*>(ptr) - 1;
+        MemStats::OnFree(header->site, header->size);
+        return IOS_Free(HeapId(heap), header);
+    }
+#endif
+
+    return IOS_Free(HeapId(heap), ptr);
+}
+
+/*
+ * Carve out every pool from its heap. Until this is called all allocations go
+ * straight to the heap. System heap pools are accounted to Init in MemStats.
+ */
+void Init()
+{
+    s_lock = new Mutex;
+
+    for (Pool& pool : s_pools) {
+        pool.base = reinterpret_cast<u8*>(
+            HeapAlloc(pool.blockSize * pool.blockCount, pool.heap,
+                      u32(uintptr_t(&Init))));
+        if (pool.base == nullptr) {
+            PRINT(IOS, ERROR, "Failed to allocate %u byte slab",
+                  pool.blockSize);
+            continue;
+        }
+
+        pool.freeList = nullptr;
+        for (u32 i = pool.blockCount; i > 0; i--) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(
+                pool.base + (i - 1) * pool.blockSize);
+            block->next = pool.freeList;
+            pool.freeList = block;
+        }
+    }
+}
+
+void* Alloc(u32 size, Heap heap)
+{
+    if (s_lock != nullptr) {
+        for (Pool& pool : s_pools) {
+            if (pool.heap != heap || pool.blockSize < size ||
+                pool.base == nullptr)
+                continue;
+
+            s_lock->lock();
+            FreeBlock* block = pool.freeList;
+            if (block != nullptr) {
+                pool.freeList = block->next;
+                pool.allocCount++;
+                if (++pool.inUse > pool.peak)
+                    pool.peak = pool.inUse;
+            } else {
+                pool.fallbackCount++;
+            }
+            s_lock->unlock();
+
+            if (block != nullptr)
+                return block;
+            break;
+        }
+    }
+
+    return HeapAlloc(size, heap, u32(uintptr_t(__builtin_return_address(0))));
+}
+
+s32 Free(void* ptr, Heap heap)
+{
+    if (ptr == nullptr)
+        return IOSError::OK;
+
+    u8* block = reinterpret_cast<u8*>(ptr);
+    for (Pool& pool : s_pools) {
+        if (pool.base == nullptr || block < pool.base ||
+            block >= pool.base + pool.blockSize * pool.blockCount)
+            continue;
+
+        ASSERT((block - pool.base) % pool.blockSize == 0);
+
+        s_lock->lock();
+        FreeBlock* freeBlock = reinterpret_cast<FreeBlock*>(block);
+        freeBlock->next = pool.freeList;
+        pool.freeList = freeBlock;
+        pool.inUse--;
+        s_lock->unlock();
+        return IOSError::OK;
+    }
+
+    return HeapFree(ptr, heap);
+}
+
+u32 GetClassCount()
+{
+    return sizeof(s_pools) / sizeof(s_pools[0]);
+}
+
+Stats GetStats(u32 index)
+{
+    ASSERT(index < GetClassCount());
+    const Pool& pool = s_pools[index];
+
+    return {
+        .heap = pool.heap,
+        .blockSize = pool.blockSize,
+        .blockCount = pool.blockCount,
+        .inUse = pool.inUse,
+        .peak = pool.peak,
+        .allocCount = pool.allocCount,
+        .fallbackCount = pool.fallbackCount,
+    };
+}
+
+} // namespace Slab
@@ -0,0 +1,37 @@
+// Slab.hpp - Fixed size block pools for recurring IOS allocations
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <System/Types.h>
+
+namespace Slab
+{
+
+enum class Heap {
+    System,
+    IPC,
+};
+
+struct Stats {
+    Heap heap;
+    u32 blockSize;
+    u32 blockCount;
+    u32 inUse;
+    u32 peak;
+    u32 allocCount;
+    // Requests that fit the class but found it full
+    u32 fallbackCount;
+};
+
+void Init();
+
+void* Alloc(u32 size, Heap heap);
+// Returns the IOS_Free result for blocks outside the pools.
+s32 Free(void* ptr, Heap heap);
+
+u32 GetClassCount();
+Stats GetStats(u32 index);
+
+} // namespace Slab
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+# symbolize_profile.py - Resolve the IOS profiler histogram in log.txt
+#
+# SPDX-License-Identifier: MIT
+#
+# Usage: symbolize_profile.py log.txt bin/saoirse_ios_dbg.elf [--lines]
+#
+# Sums the "[Prof] pc" lines written by Profiler::WriteToLog by function, or
+# by source line with --lines. Addresses outside the module, ES or the kernel,
+# come out of addr2line as "??".
+
+import os, re, subprocess, sys
+from collections import Counter
+
+if len(sys.argv) < 3:
+    print("Usage: %s log.txt saoirse_ios_dbg.elf [--lines]" % sys.argv[0])
+    sys.exit(1)
+
+logPath, elfPath = sys.argv[1], sys.argv[2]
+byLine = "--lines" in sys.argv[3:]
+
+addr2line = "arm-none-eabi-addr2line"
+if "DEVKITARM" in os.environ:
+    addr2line = os.path.join(os.environ["DEVKITARM"], "bin", addr2line)
+
+pcRe = re.compile(r"\[Prof\] pc ([0-9A-Fa-f]{8}) (\d+)")
+infoRe = re.compile(r"\[Prof\] (\d+ samples|thread )")
+
+# Only the last run in the log
+counts = {}
+info = []
+for line in open(logPath, errors="replace"):
+    if "[Prof]" in line and "samples every" in line:
+        counts = {}
+        info = []
+
+    match = pcRe.search(line)
+    if match:
+        pc = int(match.group(1), 16)
+        counts[pc] = counts.get(pc, 0) + int(match.group(2))
+    elif infoRe.search(line):
+        info.append(line[line.index("[Prof]") + 7:].rstrip())
+
+if not counts:
+    print("No profile in %s" % logPath)
+    sys.exit(1)
+
+pcs = sorted(counts)
+out = subprocess.run([addr2line, "-f", "-C", "-e", elfPath] +
+                     ["%08X" % pc for pc in pcs],
+                     capture_output=True, text=True, check=True).stdout
+lines = out.splitlines()
+
+totals = Counter()
+for i, pc in enumerate(pcs):
+    function, location = lines[i * 2], lines[i * 2 + 1]
+    if byLine:
+        key = "%s (%s)" % (function, os.path.basename(location))
+    else:
+        key = function
+    totals[key] += counts[pc]
+
+for line in info:
+    print(line)
+print()
+
+total = sum(totals.values())
+for key, count in totals.most_common():
+    print("%6d %5.1f%%  %s" % (count, count * 100.0 / total, key))
@@ -0,0 +1,56 @@
+#---------------------------------------------------------------------------------
+# ARM build of System/Memory.s, checked against newlib's memcpy and memset by
+# host/System/MemCheck.c under user mode emulation. Needs devkitARM with the
+# rdimon semihosting specs, and qemu-armeb. Memory.s doesn't depend on byte
+# order, so ENDIAN=-mlittle-endian QEMU=qemu-arm works as well.
+#---------------------------------------------------------------------------------
+.SUFFIXES:
+
+TARGET		:=	memcheck
+BUILD		:=	build_memcheck
+BIN			:=	bin
+
+PREFIX		?=	$(DEVKITARM)/bin/arm-none-eabi-
+CC			:=	$(PREFIX)gcc
+OBJCOPY		:=	$(PREFIX)objcopy
+QEMU		?=	qemu-armeb
+
+ENDIAN		?=	-mbig-endian
+ARCH		:=	-march=armv5te -mtune=arm9tdmi -mthumb-interwork $(ENDIAN)
+SPECS		?=	--specs=rdimon.specs
+
+# No builtins, so the reference calls really go to newlib
+CFLAGS		:=	$(ARCH) -Icommon -O2 -DTARGET_IOS -Wall -Wextra -fno-builtin
+AFLAGS		:=	$(ARCH) -x assembler-with-cpp
+
+DUMMY != mkdir -p $(BIN) $(BUILD)
+
+OUTPUT		:=	$(BIN)/$(TARGET).elf
+
+.PHONY: default run clean
+
+default: run
+
+run: $(OUTPUT)
+	@echo running ... $(notdir $<)
+	@$(QEMU) $<
+
+clean:
+	@echo cleaning...
+	@rm -rf $(OUTPUT) $(BUILD)
+
+$(OUTPUT): $(BUILD)/Memory_s.o $(BUILD)/MemCheck_c.o
+	@echo linking ... $(notdir $@)
+	@$(CC) $(ARCH) $(SPECS) -o $@ $^
+
+# Renamed, as newlib's memcpy and memset are the reference
+$(BUILD)/Memory_s.o: ios/System/Memory.s
+	@echo $(notdir $<)
+	@$(CC) $(AFLAGS) -c $< -o $@.tmp
+	@$(OBJCOPY) --redefine-sym memcpy=burst_memcpy \
+		--redefine-sym memset=burst_memset $@.tmp $@
+	@rm -f $@.tmp
+
+$(BUILD)/MemCheck_c.o: host/System/MemCheck.c
+	@echo $(notdir $<)
+	@$(CC) $(CFLAGS) -c $< -o $@